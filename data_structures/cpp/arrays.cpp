@@ -1,10 +1,868 @@
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
+#include "inlineVector.h"
+#include "pipeline.h"
+
+// Vectorized search kernels behind CustomArray::contains, index, count, indexOfAny and
+// countInRange for arithmetic element types. Each kernel is written once with GCC vector
+// extensions and instantiated per instruction set inside a target-specific wrapper, so the
+// same loop becomes SSE2, AVX2 or AVX-512 code; the widest set the CPU supports is picked
+// at runtime, with a scalar loop everywhere else.
+namespace arraySearch {
+
+// Element types with a vector equivalent (long double has none, and bool compares oddly)
+template <typename T>
+constexpr bool isVectorizable = std::is_arithmetic<T>::value && !std::is_same<T, bool>::value &&
+                                !std::is_same<T, long double>::value;
+
+// Unsigned integer as wide as T, for per-lane match counters
+template <typename T>
+using Lane = std::conditional_t<sizeof(T) == 1, uint8_t,
+             std::conditional_t<sizeof(T) == 2, uint16_t, std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>>;
+
+// Needle sets larger than this are searched with the scalar loop
+constexpr size_t maxVectorNeedles = 16;
+
+enum class SimdLevel { scalar, sse2, avx2, avx512 };
+
+// Helpers take vectors by reference: passing them by value from code built for a narrower
+// instruction set would change the calling convention.
+
+template <typename Vector, typename T>
+__attribute__((always_inline)) inline void load(Vector& block, const T* data) {
+    std::memcpy(&block, data, sizeof(Vector));
+}
+
+template <typename Vector, typename T>
+__attribute__((always_inline)) inline void broadcast(Vector& vector, T value) {
+    for (size_t lane = 0; lane < sizeof(Vector) / sizeof(T); ++lane) {
+        vector[lane] = value;
+    }
+}
+
+// Sum of the per-lane counters; 8- and 16-bit counters are flushed before they can wrap.
+template <typename Counters>
+__attribute__((always_inline)) inline size_t sumLanes(const Counters& counters) {
+    size_t total = 0;
+    for (size_t lane = 0; lane < sizeof(Counters) / sizeof(counters[0]); ++lane) {
+        total += counters[lane];
+    }
+    return total;
+}
+
+template <typename T>
+constexpr size_t blocksBeforeFlush = sizeof(T) >= 4 ? SIZE_MAX : (size_t(1) << (8 * sizeof(T))) - 1;
+
+// Kernels
+//
+// Isa supplies the vector width in bytes and byteMask(), which turns a comparison result
+// into an integer with one bit per byte. Matches are combined as integers: GCC 12 falls
+// back to scalar code when it has to OR AVX-512 comparison results as vectors.
+
+template <typename Isa, typename T>
+__attribute__((always_inline)) inline size_t findFirstIn(const T* data, size_t count, T value) {
+    typedef T Vector __attribute__((vector_size(Isa::bytes)));
+    constexpr size_t lanes = Isa::bytes / sizeof(T);
+    Vector needle;
+    broadcast(needle, value);
+    size_t i = 0;
+    // Test four vectors per step; the scalar tail pins down the match inside a hit.
+    for (; i + 4 * lanes <= count; i += 4 * lanes) {
+        Vector first, second, third, fourth;
+        load(first, data + i);
+        load(second, data + i + lanes);
+        load(third, data + i + 2 * lanes);
+        load(fourth, data + i + 3 * lanes);
+        if (Isa::byteMask(first == needle) | Isa::byteMask(second == needle) | Isa::byteMask(third == needle) |
+            Isa::byteMask(fourth == needle)) {
+            break;
+        }
+    }
+    for (; i < count; ++i) {
+        if (data[i] == value) {
+            return i;
+        }
+    }
+    return count;
+}
+
+template <typename Isa, typename T>
+__attribute__((always_inline)) inline size_t countIn(const T* data, size_t count, T value) {
+    typedef T Vector __attribute__((vector_size(Isa::bytes)));
+    typedef Lane<T> Counters __attribute__((vector_size(Isa::bytes)));
+    constexpr size_t lanes = Isa::bytes / sizeof(T);
+    Vector needle;
+    broadcast(needle, value);
+    Counters counters{};
+    size_t total = 0;
+    size_t blocks = 0;
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes) {
+        Vector block;
+        load(block, data + i);
+        counters -= (Counters)(block == needle);
+        if (++blocks == blocksBeforeFlush<T>) {
+            total += sumLanes(counters);
+            counters = Counters{};
+            blocks = 0;
+        }
+    }
+    total += sumLanes(counters);
+    for (; i < count; ++i) {
+        total += data[i] == value;
+    }
+    return total;
+}
+
+template <typename Isa, typename T>
+__attribute__((always_inline)) inline size_t findFirstOfIn(const T* data, size_t count, const T* needles,
+                                                           size_t needleCount) {
+    typedef T Vector __attribute__((vector_size(Isa::bytes)));
+    constexpr size_t lanes = Isa::bytes / sizeof(T);
+    Vector broadcasts[maxVectorNeedles];
+    for (size_t j = 0; j < needleCount; ++j) {
+        broadcast(broadcasts[j], needles[j]);
+    }
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes) {
+        Vector block;
+        load(block, data + i);
+        uint64_t matches = 0;
+        for (size_t j = 0; j < needleCount; ++j) {
+            matches |= Isa::byteMask(block == broadcasts[j]);
+        }
+        if (matches != 0) {
+            break;
+        }
+    }
+    for (; i < count; ++i) {
+        if (std::find(needles, needles + needleCount, data[i]) != needles + needleCount) {
+            return i;
+        }
+    }
+    return count;
+}
+
+// Counts low <= x <= high as (x >= low) - (x > high), which needs no AND of two comparison
+// results and still leaves out NaN.
+template <typename Isa, typename T>
+__attribute__((always_inline)) inline size_t countInRangeIn(const T* data, size_t count, T low, T high) {
+    typedef T Vector __attribute__((vector_size(Isa::bytes)));
+    typedef Lane<T> Counters __attribute__((vector_size(Isa::bytes)));
+    constexpr size_t lanes = Isa::bytes / sizeof(T);
+    if (!(low <= high)) {
+        return 0;
+    }
+    Vector lows;
+    Vector highs;
+    broadcast(lows, low);
+    broadcast(highs, high);
+    Counters counters{};
+    size_t total = 0;
+    size_t blocks = 0;
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes) {
+        Vector block;
+        load(block, data + i);
+        counters -= (Counters)(block >= lows);
+        counters += (Counters)(block > highs);
+        if (++blocks == blocksBeforeFlush<T>) {
+            total += sumLanes(counters);
+            counters = Counters{};
+            blocks = 0;
+        }
+    }
+    total += sumLanes(counters);
+    for (; i < count; ++i) {
+        total += low <= data[i] && data[i] <= high;
+    }
+    return total;
+}
+
+// Instruction-set instantiations
+
+#if defined(__x86_64__) || defined(__i386__)
+struct Sse2 {
+    static constexpr size_t bytes = 16;
+
+    template <typename Mask>
+    __attribute__((target("sse2"))) static uint64_t byteMask(const Mask& mask) {
+        __m128i bits;
+        std::memcpy(&bits, &mask, sizeof(bits));
+        return static_cast<uint32_t>(_mm_movemask_epi8(bits));
+    }
+
+    template <typename T>
+    __attribute__((target("sse2"))) static size_t findFirst(const T* data, size_t count, T value) {
+        return findFirstIn<Sse2>(data, count, value);
+    }
+    template <typename T>
+    __attribute__((target("sse2"))) static size_t countOf(const T* data, size_t count, T value) {
+        return countIn<Sse2>(data, count, value);
+    }
+    template <typename T>
+    __attribute__((target("sse2"))) static size_t findFirstOf(const T* data, size_t count, const T* needles,
+                                                              size_t needleCount) {
+        return findFirstOfIn<Sse2>(data, count, needles, needleCount);
+    }
+    template <typename T>
+    __attribute__((target("sse2"))) static size_t countInRange(const T* data, size_t count, T low, T high) {
+        return countInRangeIn<Sse2>(data, count, low, high);
+    }
+};
+
+struct Avx2 {
+    static constexpr size_t bytes = 32;
+
+    template <typename Mask>
+    __attribute__((target("avx2"))) static uint64_t byteMask(const Mask& mask) {
+        __m256i bits;
+        std::memcpy(&bits, &mask, sizeof(bits));
+        return static_cast<uint32_t>(_mm256_movemask_epi8(bits));
+    }
+
+    template <typename T>
+    __attribute__((target("avx2"))) static size_t findFirst(const T* data, size_t count, T value) {
+        return findFirstIn<Avx2>(data, count, value);
+    }
+    template <typename T>
+    __attribute__((target("avx2"))) static size_t countOf(const T* data, size_t count, T value) {
+        return countIn<Avx2>(data, count, value);
+    }
+    template <typename T>
+    __attribute__((target("avx2"))) static size_t findFirstOf(const T* data, size_t count, const T* needles,
+                                                              size_t needleCount) {
+        return findFirstOfIn<Avx2>(data, count, needles, needleCount);
+    }
+    template <typename T>
+    __attribute__((target("avx2"))) static size_t countInRange(const T* data, size_t count, T low, T high) {
+        return countInRangeIn<Avx2>(data, count, low, high);
+    }
+};
+
+struct Avx512 {
+    static constexpr size_t bytes = 64;
+
+    template <typename Mask>
+    __attribute__((target("avx512f,avx512bw"))) static uint64_t byteMask(const Mask& mask) {
+        __m512i bits;
+        std::memcpy(&bits, &mask, sizeof(bits));
+        return _mm512_movepi8_mask(bits);
+    }
+
+    template <typename T>
+    __attribute__((target("avx512f,avx512bw"))) static size_t findFirst(const T* data, size_t count, T value) {
+        return findFirstIn<Avx512>(data, count, value);
+    }
+    template <typename T>
+    __attribute__((target("avx512f,avx512bw"))) static size_t countOf(const T* data, size_t count, T value) {
+        return countIn<Avx512>(data, count, value);
+    }
+    template <typename T>
+    __attribute__((target("avx512f,avx512bw"))) static size_t findFirstOf(const T* data, size_t count,
+                                                                          const T* needles, size_t needleCount) {
+        return findFirstOfIn<Avx512>(data, count, needles, needleCount);
+    }
+    template <typename T>
+    __attribute__((target("avx512f,avx512bw"))) static size_t countInRange(const T* data, size_t count, T low,
+                                                                           T high) {
+        return countInRangeIn<Avx512>(data, count, low, high);
+    }
+};
+#endif
+
+// Runtime dispatch
+
+SimdLevel detectedSimdLevel() {
+#if defined(__x86_64__) || defined(__i386__)
+    static const SimdLevel detected = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+                                          ? SimdLevel::avx512
+                                          : __builtin_cpu_supports("avx2") ? SimdLevel::avx2
+                                          : __builtin_cpu_supports("sse2") ? SimdLevel::sse2
+                                                                           : SimdLevel::scalar;
+    return detected;
+#else
+    return SimdLevel::scalar;
+#endif
+}
+
+// The level the kernels run at: the detected one unless capped (benchmarks compare levels).
+SimdLevel& activeSimdLevel() {
+    static SimdLevel level = detectedSimdLevel();
+    return level;
+}
+
+void setSimdLevel(SimdLevel level) {
+    activeSimdLevel() = std::min(level, detectedSimdLevel());
+}
+
+// Calls kernel(Isa) for the active instruction set, or scalar() without one.
+template <typename Kernel, typename Scalar>
+size_t dispatch(Kernel kernel, Scalar scalar) {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (activeSimdLevel()) {
+        case SimdLevel::avx512:
+            return kernel(Avx512());
+        case SimdLevel::avx2:
+            return kernel(Avx2());
+        case SimdLevel::sse2:
+            return kernel(Sse2());
+        case SimdLevel::scalar:
+            break;
+    }
+#endif
+    return scalar();
+}
+
+// Index of the first element equal to `value`, or `count` if there is none
+template <typename T>
+size_t findFirst(const T* data, size_t count, T value) {
+    return dispatch([&](auto isa) { return decltype(isa)::findFirst(data, count, value); },
+                    [&] { return static_cast<size_t>(std::find(data, data + count, value) - data); });
+}
+
+// Number of elements equal to `value`
+template <typename T>
+size_t countOf(const T* data, size_t count, T value) {
+    return dispatch([&](auto isa) { return decltype(isa)::countOf(data, count, value); },
+                    [&] { return static_cast<size_t>(std::count(data, data + count, value)); });
+}
+
+// Index of the first element equal to any of the needles, or `count` if there is none
+template <typename T>
+size_t findFirstOf(const T* data, size_t count, const T* needles, size_t needleCount) {
+    if (needleCount == 0) {
+        return count;
+    }
+    auto scalar = [&] {
+        return static_cast<size_t>(std::find_first_of(data, data + count, needles, needles + needleCount) - data);
+    };
+    if (needleCount > maxVectorNeedles) {
+        return scalar();
+    }
+    return dispatch([&](auto isa) { return decltype(isa)::findFirstOf(data, count, needles, needleCount); }, scalar);
+}
+
+// Number of elements in [low, high]
+template <typename T>
+size_t countInRange(const T* data, size_t count, T low, T high) {
+    return dispatch([&](auto isa) { return decltype(isa)::countInRange(data, count, low, high); },
+                    [&] {
+                        return static_cast<size_t>(std::count_if(
+                            data, data + count, [&](T element) { return low <= element && element <= high; }));
+                    });
+}
+
+}  // namespace arraySearch
+
+// Sort engine behind CustomArray::sort and sortBy. Arithmetic keys of trivially copyable
+// elements go through an LSD radix sort (8-bit digits, stable by construction); everything
+// else uses std::sort, or std::stable_sort when stability is asked for. Large inputs are cut
+// into one run per hardware thread, the runs are sorted concurrently and then merged in
+// rounds, with each merge itself split across the threads.
+namespace arraySort {
+
+// Below this many elements the comparison sort wins over radix passes
+constexpr size_t radixThreshold = 1024;
+
+// Below this many elements thread start-up costs more than it saves
+constexpr size_t parallelThreshold = size_t(1) << 20;
+
+template <typename Key>
+constexpr bool isRadixKey = arraySearch::isVectorizable<Key>;
+
+// Unsigned integer whose ascending order matches the ascending order of `key`: the sign bit
+// is flipped for signed integers, and negative floating-point values have all bits flipped.
+template <typename Key>
+arraySearch::Lane<Key> radixBits(Key key) {
+    using Bits = arraySearch::Lane<Key>;
+    constexpr Bits signBit = Bits(1) << (8 * sizeof(Key) - 1);
+    Bits bits;
+    std::memcpy(&bits, &key, sizeof(bits));
+    if constexpr (std::is_floating_point<Key>::value) {
+        if (key == Key(0)) {
+            // -0.0 compares equal to +0.0, so it must get the same key or a stable sort
+            // would move every -0.0 ahead of the +0.0 values around it.
+            return signBit;
+        }
+        return (bits & signBit) ? static_cast<Bits>(~bits) : static_cast<Bits>(bits | signBit);
+    } else if constexpr (std::is_signed<Key>::value) {
+        return static_cast<Bits>(bits ^ signBit);
+    } else {
+        return bits;
+    }
+}
+
+// Stable LSD radix sort of [data, data + count) by keyOf, using scratch (count elements).
+// Digits every element shares, as in sorted or few-unique inputs, skip their pass.
+template <typename T, typename KeyOf>
+void radixSort(T* data, size_t count, T* scratch, KeyOf keyOf) {
+    using Bits = decltype(radixBits(keyOf(*data)));
+    constexpr size_t passes = sizeof(Bits);
+    size_t histograms[passes][256] = {};
+    for (size_t i = 0; i < count; ++i) {
+        Bits bits = radixBits(keyOf(data[i]));
+        for (size_t pass = 0; pass < passes; ++pass) {
+            ++histograms[pass][(bits >> (8 * pass)) & 0xFF];
+        }
+    }
+    T* from = data;
+    T* to = scratch;
+    for (size_t pass = 0; pass < passes; ++pass) {
+        size_t* offsets = histograms[pass];
+        if (offsets[(radixBits(keyOf(from[0])) >> (8 * pass)) & 0xFF] == count) {
+            continue;
+        }
+        size_t offset = 0;
+        for (size_t digit = 0; digit < 256; ++digit) {
+            size_t digitCount = offsets[digit];
+            offsets[digit] = offset;
+            offset += digitCount;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            to[offsets[(radixBits(keyOf(from[i])) >> (8 * pass)) & 0xFF]++] = from[i];
+        }
+        std::swap(from, to);
+    }
+    if (from != data) {
+        std::copy(from, from + count, data);
+    }
+}
+
+// Run task(0) .. task(taskCount - 1) on their own threads and rethrow the first failure.
+template <typename Task>
+void runInParallel(size_t taskCount, Task task) {
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> failures(taskCount);
+    threads.reserve(taskCount);
+    for (size_t index = 0; index < taskCount; ++index) {
+        threads.emplace_back([&, index] {
+            try {
+                task(index);
+            } catch (...) {
+                failures[index] = std::current_exception();
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (const std::exception_ptr& failure : failures) {
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+    }
+}
+
+// Merge the sorted ranges left and right into output as `parts` independent pieces. Each
+// piece starts at an evenly spaced element of left and at the first element of right not
+// less than it, which keeps the merge stable.
+template <typename T, typename Less>
+void parallelMerge(T* left, size_t leftCount, T* right, size_t rightCount, T* output, size_t parts, Less less) {
+    std::vector<size_t> leftStarts(parts + 1);
+    std::vector<size_t> rightStarts(parts + 1);
+    for (size_t part = 0; part <= parts; ++part) {
+        leftStarts[part] = leftCount * part / parts;
+        if (part == 0 || part == parts) {
+            rightStarts[part] = part == 0 ? 0 : rightCount;
+        } else {
+            rightStarts[part] = static_cast<size_t>(
+                std::lower_bound(right, right + rightCount, left[leftStarts[part]], less) - right);
+        }
+    }
+    runInParallel(parts, [&](size_t part) {
+        std::merge(std::make_move_iterator(left + leftStarts[part]),
+                   std::make_move_iterator(left + leftStarts[part + 1]),
+                   std::make_move_iterator(right + rightStarts[part]),
+                   std::make_move_iterator(right + rightStarts[part + 1]),
+                   output + leftStarts[part] + rightStarts[part], less);
+    });
+}
+
+// Sort one run per thread with sortRun, then merge neighbouring runs pairwise until one is left.
+template <typename T, typename Less, typename SortRun>
+void parallelSort(T* data, size_t count, size_t threadCount, Less less, SortRun sortRun) {
+    std::vector<size_t> bounds(threadCount + 1);
+    for (size_t run = 0; run <= threadCount; ++run) {
+        bounds[run] = count * run / threadCount;
+    }
+    runInParallel(threadCount, [&](size_t run) { sortRun(data + bounds[run], bounds[run + 1] - bounds[run]); });
+
+    std::vector<T> buffer(data, data + count);
+    T* from = data;
+    T* to = buffer.data();
+    for (size_t width = 1; width < threadCount; width *= 2) {
+        size_t pairs = (threadCount + 2 * width - 1) / (2 * width);
+        size_t parts = std::max<size_t>(1, threadCount / pairs);
+        for (size_t run = 0; run < threadCount; run += 2 * width) {
+            size_t begin = bounds[run];
+            size_t middle = bounds[std::min(run + width, threadCount)];
+            size_t end = bounds[std::min(run + 2 * width, threadCount)];
+            if (middle == end || middle == begin) {
+                std::move(from + begin, from + end, to + begin);
+            } else {
+                parallelMerge(from + begin, middle - begin, from + middle, end - middle, to + begin, parts, less);
+            }
+        }
+        std::swap(from, to);
+    }
+    if (from != data) {
+        std::move(from, from + count, data);
+    }
+}
+
+size_t hardwareThreads() {
+    static const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    return threads;
+}
+
+// Sort [data, data + count) ascending by keyOf(element) on up to threadCount threads.
+template <typename T, typename KeyOf>
+void sortBy(T* data, size_t count, KeyOf keyOf, bool stable, size_t threadCount = hardwareThreads()) {
+    using Key = std::decay_t<decltype(keyOf(*data))>;
+    constexpr bool radixable = isRadixKey<Key> && std::is_trivially_copyable<T>::value &&
+                               std::is_default_constructible<T>::value;
+    auto less = [&](const T& left, const T& right) { return keyOf(left) < keyOf(right); };
+    auto sortRun = [&](T* first, size_t runCount) {
+        if constexpr (radixable) {
+            if (runCount >= radixThreshold) {
+                std::vector<T> scratch(runCount);
+                radixSort(first, runCount, scratch.data(), keyOf);
+                return;
+            }
+        }
+        if (stable) {
+            std::stable_sort(first, first + runCount, less);
+        } else {
+            std::sort(first, first + runCount, less);
+        }
+    };
+    // Already ascending or descending input costs one early-exiting scan instead of a sort. A
+    // stable sort may only reverse strictly descending input, which has no equal elements.
+    if (std::is_sorted(data, data + count, less)) {
+        return;
+    }
+    auto ascendsAt = [&](const T& left, const T& right) { return stable ? !less(right, left) : less(left, right); };
+    if (std::adjacent_find(data, data + count, ascendsAt) == data + count) {
+        std::reverse(data, data + count);
+        return;
+    }
+    if (threadCount > 1 && count >= parallelThreshold) {
+        parallelSort(data, count, threadCount, less, sortRun);
+    } else {
+        sortRun(data, count);
+    }
+}
+
+}  // namespace arraySort
+
+// Non-owning, read-only views over a CustomArray's storage, returned by view, sliceView,
+// stridedView and chunks in place of copies. A view is valid until its array changes size
+// (append, insert, remove, pop, extend, clear), is assigned to or is destroyed. Builds without
+// NDEBUG check this on each access: the array bumps a generation counter shared with its views.
+namespace arrayViews {
+
+#ifndef NDEBUG
+// The generation a view was created at; stale once the array's counter has moved on.
+class Stamp {
+private:
+    std::shared_ptr<const size_t> generation;
+    size_t expected = 0;
+
+public:
+    Stamp() = default;
+    Stamp(std::shared_ptr<const size_t> generation) : generation(generation), expected(*generation) {}
+
+    void check() const {
+        assert((generation == nullptr || *generation == expected) &&
+               "View used after its CustomArray changed size or was destroyed");
+    }
+};
+
+// The array's side. The counter is allocated with the first view, so arrays that never hand
+// out views stay free of it; a copied array starts with no counter of its own.
+class Guard {
+private:
+    mutable std::shared_ptr<size_t> generation;
+
+public:
+    Guard() = default;
+    Guard(const Guard&) {}
+    Guard(Guard&& other) noexcept {
+        other.invalidate();
+    }
+    Guard& operator=(const Guard&) {
+        invalidate();
+        return *this;
+    }
+    Guard& operator=(Guard&& other) noexcept {
+        invalidate();
+        other.invalidate();
+        return *this;
+    }
+    ~Guard() {
+        invalidate();
+    }
+
+    void invalidate() {
+        if (generation != nullptr) {
+            ++*generation;
+        }
+    }
+
+    Stamp stamp() const {
+        if (generation == nullptr) {
+            generation = std::make_shared<size_t>(0);
+        }
+        return Stamp(generation);
+    }
+};
+#else
+class Stamp {
+public:
+    void check() const {}
+};
+
+class Guard {
+public:
+    void invalidate() {}
+    Stamp stamp() const {
+        return Stamp();
+    }
+};
+#endif
+
+}  // namespace arrayViews
+
+// Contiguous run of elements
 template <typename T>
+class ArrayView : private arrayViews::Stamp {
+private:
+    const T* first;
+    size_t count;
+
+public:
+    ArrayView(const T* first, size_t count, arrayViews::Stamp stamp = arrayViews::Stamp())
+        : arrayViews::Stamp(stamp), first(first), count(count) {}
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    const T* data() const {
+        check();
+        return first;
+    }
+
+    const T* begin() const {
+        check();
+        return first;
+    }
+
+    const T* end() const {
+        check();
+        return first + count;
+    }
+
+    const T& operator[](size_t index) const {
+        check();
+        assert(index < count && "View index out of range");
+        return first[index];
+    }
+
+    // Elements [offset, offset + length) of this view, clamped to its end
+    ArrayView subview(size_t offset, size_t length) const {
+        offset = std::min(offset, count);
+        return ArrayView(first + offset, std::min(length, count - offset), *this);
+    }
+
+    std::vector<T> toVector() const {
+        return std::vector<T>(begin(), end());
+    }
+};
+
+// Every step-th element of a run
+template <typename T>
+class StridedView : private arrayViews::Stamp {
+private:
+    const T* first;
+    size_t count;
+    size_t step;
+
+public:
+    class Iterator {
+    private:
+        const T* first;
+        size_t step;
+        size_t index;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        Iterator(const T* first, size_t step, size_t index) : first(first), step(step), index(index) {}
+
+        const T& operator*() const {
+            return first[index * step];
+        }
+
+        Iterator& operator++() {
+            ++index;
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return index == other.index;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return index != other.index;
+        }
+    };
+
+    StridedView(const T* first, size_t count, size_t step, arrayViews::Stamp stamp = arrayViews::Stamp())
+        : arrayViews::Stamp(stamp), first(first), count(count), step(step) {}
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    Iterator begin() const {
+        check();
+        return Iterator(first, step, 0);
+    }
+
+    Iterator end() const {
+        check();
+        return Iterator(first, step, count);
+    }
+
+    const T& operator[](size_t index) const {
+        check();
+        assert(index < count && "View index out of range");
+        return first[index * step];
+    }
+
+    std::vector<T> toVector() const {
+        std::vector<T> result;
+        result.reserve(count);
+        for (const T& element : *this) {
+            result.push_back(element);
+        }
+        return result;
+    }
+};
+
+// Consecutive ArrayViews of chunkSize elements; the last one may be shorter
+template <typename T>
+class ChunkedView : private arrayViews::Stamp {
+private:
+    const T* first;
+    size_t count;
+    size_t chunkSize;
+
+public:
+    class Iterator {
+    private:
+        const T* current;
+        const T* last;
+        size_t chunkSize;
+        arrayViews::Stamp stamp;
+
+        size_t currentSize() const {
+            return std::min(chunkSize, static_cast<size_t>(last - current));
+        }
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = ArrayView<T>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = ArrayView<T>;
+
+        Iterator(const T* current, const T* last, size_t chunkSize, arrayViews::Stamp stamp)
+            : current(current), last(last), chunkSize(chunkSize), stamp(stamp) {}
+
+        ArrayView<T> operator*() const {
+            return ArrayView<T>(current, currentSize(), stamp);
+        }
+
+        Iterator& operator++() {
+            current += currentSize();
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return current == other.current;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return current != other.current;
+        }
+    };
+
+    ChunkedView(const T* first, size_t count, size_t chunkSize, arrayViews::Stamp stamp = arrayViews::Stamp())
+        : arrayViews::Stamp(stamp), first(first), count(count), chunkSize(chunkSize) {}
+
+    // Number of chunks
+    size_t size() const {
+        return (count + chunkSize - 1) / chunkSize;
+    }
+
+    Iterator begin() const {
+        check();
+        return Iterator(first, first + count, chunkSize, *this);
+    }
+
+    Iterator end() const {
+        check();
+        return Iterator(first + count, first + count, chunkSize, *this);
+    }
+};
+
+// InlineCapacity > 0 keeps up to that many elements inside the array itself, with no heap
+// allocation; the default 0 stores them in a std::vector. Heap storage comes from Allocator.
+template <typename T, size_t InlineCapacity = 0, typename Allocator = std::allocator<T>>
 class CustomArray {
 private:
-    std::vector<T> elements;  // Internal storage for elements
+    using Storage = std::conditional_t<InlineCapacity == 0, std::vector<T, Allocator>,
+                                       InlineVector<T, InlineCapacity, Allocator>>;
+
+    // std::vector<bool> packs its elements into bits and has no data(), so it is sorted
+    // through its iterators rather than handed to arraySort as a pointer.
+    static constexpr bool contiguous = !std::is_same<Storage, std::vector<bool, Allocator>>::value;
+
+    Storage elements;  // Internal storage for elements
+    arrayViews::Guard viewGuard;  // Invalidates views when the elements move or change count
 
 public:
     // Initialize the custom array with a specified initial size
@@ -14,11 +872,13 @@ public:
 
     // Append an element to the end of the custom array
     void append(T element) {
+        viewGuard.invalidate();
         elements.push_back(element);
     }
 
     // Insert an element at the specified index
     void insert(T element, int index) {
+        viewGuard.invalidate();
         elements.insert(elements.begin() + index, element);
     }
 
@@ -26,6 +886,7 @@ public:
     void remove(T element) {
         auto it = std::find(elements.begin(), elements.end(), element);
         if (it != elements.end()) {
+            viewGuard.invalidate();
             elements.erase(it);
         }
     }
@@ -34,6 +895,7 @@ public:
     T pop(int index) {
         if (index >= 0 && index < elements.size()) {
             T element = elements[index];
+            viewGuard.invalidate();
             elements.erase(elements.begin() + index);
             return element;
         }
@@ -67,16 +929,47 @@ public:
 
     // Return the index of the first occurrence of the specified element, or -1 if not found
     int index(T element) {
-        auto it = std::find(elements.begin(), elements.end(), element);
-        if (it != elements.end()) {
-            return std::distance(elements.begin(), it);
+        if constexpr (arraySearch::isVectorizable<T>) {
+            size_t found = arraySearch::findFirst(elements.data(), elements.size(), element);
+            return found == elements.size() ? -1 : static_cast<int>(found);
+        } else {
+            auto it = std::find(elements.begin(), elements.end(), element);
+            if (it != elements.end()) {
+                return std::distance(elements.begin(), it);
+            }
+            return -1;
+        }
+    }
+
+    // Return the index of the first element equal to any of the given elements, or -1 if not found
+    int indexOfAny(const std::vector<T>& candidates) {
+        size_t found;
+        if constexpr (arraySearch::isVectorizable<T>) {
+            found = arraySearch::findFirstOf(elements.data(), elements.size(), candidates.data(), candidates.size());
+        } else {
+            found = std::find_first_of(elements.begin(), elements.end(), candidates.begin(), candidates.end()) -
+                    elements.begin();
         }
-        return -1;
+        return found == elements.size() ? -1 : static_cast<int>(found);
     }
 
     // Return the number of occurrences of the specified element in the custom array
     int count(T element) {
-        return std::count(elements.begin(), elements.end(), element);
+        if constexpr (arraySearch::isVectorizable<T>) {
+            return arraySearch::countOf(elements.data(), elements.size(), element);
+        } else {
+            return std::count(elements.begin(), elements.end(), element);
+        }
+    }
+
+    // Return the number of elements between low and high, inclusive
+    int countInRange(T low, T high) {
+        if constexpr (arraySearch::isVectorizable<T>) {
+            return arraySearch::countInRange(elements.data(), elements.size(), low, high);
+        } else {
+            return std::count_if(elements.begin(), elements.end(),
+                                 [&](const T& element) { return low <= element && element <= high; });
+        }
     }
 
     // Reverse the order of elements in the custom array
@@ -84,32 +977,82 @@ public:
         std::reverse(elements.begin(), elements.end());
     }
 
-    // Sort the elements in the custom array in ascending order
-    void sort() {
-        std::sort(elements.begin(), elements.end());
+    // Sort the elements in the custom array in ascending order; a stable sort keeps equal
+    // elements in their current order
+    void sort(bool stable = false) {
+        sortBy([](const T& element) -> const T& { return element; }, stable);
+    }
+
+    // Sort the elements in ascending order of keyOf(element), for example a member of a struct
+    template <typename KeyOf>
+    void sortBy(KeyOf keyOf, bool stable = false) {
+        if constexpr (contiguous) {
+            arraySort::sortBy(elements.data(), elements.size(), keyOf, stable);
+        } else {
+            auto less = [&](const T& left, const T& right) { return keyOf(left) < keyOf(right); };
+            if (stable) {
+                std::stable_sort(elements.begin(), elements.end(), less);
+            } else {
+                std::sort(elements.begin(), elements.end(), less);
+            }
+        }
     }
 
     // Return a new array containing elements from the specified start index to the end index
     std::vector<T> slice(int start, int end) {
-        if (start >= 0 && end < elements.size() && start <= end) {
+        if (start >= 0 && static_cast<size_t>(end) < elements.size() && start <= end) {
             return std::vector<T>(elements.begin() + start, elements.begin() + end + 1);
         }
         return std::vector<T>();
     }
 
+    // Read-only view of the whole array
+    ArrayView<T> view() const {
+        return ArrayView<T>(elements.data(), elements.size(), viewGuard.stamp());
+    }
+
+    // Read-only view of the elements from the start index to the end index, like slice() but
+    // without copying; empty when the range is invalid
+    ArrayView<T> sliceView(int start, int end) const {
+        if (start >= 0 && static_cast<size_t>(end) < elements.size() && start <= end) {
+            return ArrayView<T>(elements.data() + start, end - start + 1, viewGuard.stamp());
+        }
+        return ArrayView<T>(elements.data(), 0, viewGuard.stamp());
+    }
+
+    // Read-only view of every step-th element from the start index up to the end index
+    StridedView<T> stridedView(int start, int end, int step) const {
+        assert(step > 0 && "Step should be greater than 0");
+        if (start >= 0 && static_cast<size_t>(end) < elements.size() && start <= end) {
+            return StridedView<T>(elements.data() + start, (end - start) / step + 1, step, viewGuard.stamp());
+        }
+        return StridedView<T>(elements.data(), 0, step, viewGuard.stamp());
+    }
+
+    // Consecutive read-only views of chunkSize elements for batch processing; the last chunk
+    // holds whatever remains
+    ChunkedView<T> chunks(size_t chunkSize) const {
+        assert(chunkSize > 0 && "Chunk size should be greater than 0");
+        return ChunkedView<T>(elements.data(), elements.size(), chunkSize, viewGuard.stamp());
+    }
+
     // Append elements from another custom array to the end of this custom array
     void extend(const CustomArray& otherArray) {
+        viewGuard.invalidate();
+        // Reserving first keeps a self-extend from reading elements the reallocation moved away
+        elements.reserve(elements.size() + otherArray.elements.size());
         elements.insert(elements.end(), otherArray.elements.begin(), otherArray.elements.end());
     }
 
     // Remove all elements from the custom array
     void clear() {
+        viewGuard.invalidate();
         elements.clear();
     }
 
     // Check if the custom array contains the specified element
     bool contains(T element) {
-        return std::find(elements.begin(), elements.end(), element) != elements.end();
+        return index(element) != -1;
     }
 
     // Return a new array with only unique elements
@@ -121,36 +1064,381 @@ public:
         return uniqueElements;
     }
 
+    // Lazy pipeline over the elements; chained map and filter stages run as a single pass
+    auto pipeline() const {
+        auto source = [this](auto&& sink) {
+            for (const T& element : elements) {
+                sink(element);
+            }
+        };
+        return Pipeline<T, decltype(source)>(source, elements.size());
+    }
+
     // Apply a transformation function to each element of the custom array
+    template <typename Transform>
+    auto map(Transform transform) const {
+        return pipeline().map(transform).toVector();
+    }
+
+    // Overload for explicit map<U>(transform) calls, which predate map taking any callable
     template <typename U>
-    std::vector<U> map(U (*transform)(T)) {
-        std::vector<U> result;
-        for (const auto& element : elements) {
-            result.push_back(transform(element));
-        }
-        return result;
+    std::vector<U> map(U (*transform)(T)) const {
+        return pipeline().map(transform).toVector();
     }
 
     // Return a new array with elements that satisfy the given filtering function
-    std::vector<T> filter(bool (*isIncluded)(T)) {
-        std::vector<T> result;
-        for (const auto& element : elements) {
-            if (isIncluded(element)) {
-                result.push_back(element);
-            }
-        }
-        return result;
+    template <typename Predicate>
+    std::vector<T> filter(Predicate isIncluded) const {
+        return pipeline().filter(isIncluded).toVector();
+    }
+
+    // Combine all elements into one value, starting from initialResult
+    template <typename Result, typename Reducer>
+    Result reduce(Result initialResult, Reducer reducer) const {
+        return pipeline().reduce(std::move(initialResult), reducer);
     }
 
     // Parameter closure: A function that takes an element of the array as a parameter.
-    void forEach(void (*closure)(T)) {
-        for (const auto& element : elements) {
-            closure(element);
+    template <typename Closure>
+    void forEach(Closure closure) const {
+        pipeline().forEach(closure);
+    }
+
+    // Iterators over the elements, for range-for loops and standard algorithms
+    typename Storage::iterator begin() {
+        return elements.begin();
+    }
+
+    typename Storage::iterator end() {
+        return elements.end();
+    }
+
+    typename Storage::const_iterator begin() const {
+        return elements.begin();
+    }
+
+    typename Storage::const_iterator end() const {
+        return elements.end();
+    }
+};
+
+// Benchmark
+
+// Written by benchmarks so the optimizer cannot drop the measured loops.
+volatile size_t benchmarkSink = 0;
+
+// Allocator that counts the heap allocations of the arrays built with it, for the
+// small-array benchmark.
+size_t countedAllocations = 0;
+
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+
+    T* allocate(size_t count) {
+        ++countedAllocations;
+        return std::allocator<T>().allocate(count);
+    }
+
+    void deallocate(T* pointer, size_t count) {
+        std::allocator<T>().deallocate(pointer, count);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>&) const {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const CountingAllocator<U>&) const {
+        return false;
+    }
+};
+
+const char* simdLevelName(arraySearch::SimdLevel level) {
+    switch (level) {
+        case arraySearch::SimdLevel::scalar:
+            return "scalar";
+        case arraySearch::SimdLevel::sse2:
+            return "SSE2";
+        case arraySearch::SimdLevel::avx2:
+            return "AVX2";
+        case arraySearch::SimdLevel::avx512:
+            return "AVX-512";
+    }
+    return "";
+}
+
+// Elements scanned per nanosecond by `scan`, repeated until about 50M elements have passed.
+template <typename Scan>
+double elementsPerNanosecond(size_t elementCount, Scan scan) {
+    size_t repeats = std::max<size_t>(1, 50000000 / elementCount);
+    auto start = std::chrono::steady_clock::now();
+    size_t result = 0;
+    for (size_t repeat = 0; repeat < repeats; ++repeat) {
+        result += scan();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    benchmarkSink = result;
+    return repeats * elementCount / std::chrono::duration<double, std::nano>(elapsed).count();
+}
+
+// Full scans (the searched value is absent) at every instruction set the CPU supports.
+template <typename T>
+void benchmarkSearch(const char* typeName) {
+    using arraySearch::SimdLevel;
+    std::mt19937 random(7);
+    for (size_t elementCount : {1000, 100000, 10000000}) {
+        std::vector<T> elements(elementCount);
+        for (T& element : elements) {
+            element = static_cast<T>(random() % 100);
+        }
+        const T* data = elements.data();
+        T absent = static_cast<T>(100);
+        std::vector<T> needles = {static_cast<T>(101), static_cast<T>(102), static_cast<T>(103), absent};
+        std::cout << "  " << typeName << " n=" << elementCount << ":";
+        for (SimdLevel level : {SimdLevel::scalar, SimdLevel::sse2, SimdLevel::avx2, SimdLevel::avx512}) {
+            if (level > arraySearch::detectedSimdLevel()) {
+                continue;
+            }
+            arraySearch::setSimdLevel(level);
+            double index = elementsPerNanosecond(elementCount, [&] { return arraySearch::findFirst(data, elementCount, absent); });
+            double count = elementsPerNanosecond(elementCount, [&] { return arraySearch::countOf(data, elementCount, absent); });
+            double any = elementsPerNanosecond(elementCount, [&] {
+                return arraySearch::findFirstOf(data, elementCount, needles.data(), needles.size());
+            });
+            double range = elementsPerNanosecond(elementCount, [&] {
+                return arraySearch::countInRange(data, elementCount, static_cast<T>(10), static_cast<T>(50));
+            });
+            std::cout << " " << simdLevelName(level) << " " << index << "/" << count << "/" << any << "/" << range << ";";
         }
+        std::cout << std::endl;
+    }
+    arraySearch::setSimdLevel(arraySearch::detectedSimdLevel());
+}
+
+void benchmarkSearches() {
+    std::cout << "Elements per ns for index / count / indexOfAny (4 needles) / countInRange" << std::endl;
+    benchmarkSearch<int8_t>("int8_t");
+    benchmarkSearch<int32_t>("int32_t");
+    benchmarkSearch<int64_t>("int64_t");
+    benchmarkSearch<float>("float");
+    benchmarkSearch<double>("double");
+}
+
+// Nanoseconds per element to sort a copy of `input` with `sortCopy`.
+template <typename T, typename Sort>
+double sortNanosecondsPerElement(const std::vector<T>& input, Sort sortCopy) {
+    size_t repeats = std::max<size_t>(1, 2000000 / input.size());
+    double total = 0;
+    for (size_t repeat = 0; repeat < repeats; ++repeat) {
+        std::vector<T> elements = input;
+        auto start = std::chrono::steady_clock::now();
+        sortCopy(elements);
+        total += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        benchmarkSink = benchmarkSink + elements.size();
     }
+    return total / (repeats * input.size());
+}
+
+struct SortRecord {
+    uint32_t id;
+    double score;
 };
 
-int main() {
+// std::sort against the sort engine on random, sorted, reverse and few-unique inputs.
+template <typename T, typename MakeElement, typename KeyOf>
+void benchmarkSort(const char* typeName, MakeElement makeElement, KeyOf keyOf) {
+    auto less = [&](const T& left, const T& right) { return keyOf(left) < keyOf(right); };
+    for (size_t elementCount : {1000, 100000, 10000000}) {
+        std::mt19937_64 random(11);
+        std::vector<T> randomInput(elementCount);
+        std::vector<T> fewUniqueInput(elementCount);
+        for (size_t i = 0; i < elementCount; ++i) {
+            randomInput[i] = makeElement(random());
+            fewUniqueInput[i] = makeElement(random() % 16);
+        }
+        std::vector<T> sortedInput = randomInput;
+        std::sort(sortedInput.begin(), sortedInput.end(), less);
+        std::vector<T> reverseInput(sortedInput.rbegin(), sortedInput.rend());
+
+        std::cout << "  " << typeName << " n=" << elementCount << ":";
+        const std::pair<const char*, const std::vector<T>*> inputs[] = {
+            {"random", &randomInput}, {"sorted", &sortedInput}, {"reverse", &reverseInput}, {"few-unique", &fewUniqueInput}};
+        for (const auto& input : inputs) {
+            double standard = sortNanosecondsPerElement(*input.second, [&](std::vector<T>& elements) {
+                std::sort(elements.begin(), elements.end(), less);
+            });
+            double engine = sortNanosecondsPerElement(*input.second, [&](std::vector<T>& elements) {
+                arraySort::sortBy(elements.data(), elements.size(), keyOf, false);
+            });
+            double stable = sortNanosecondsPerElement(*input.second, [&](std::vector<T>& elements) {
+                arraySort::sortBy(elements.data(), elements.size(), keyOf, true);
+            });
+            std::cout << " " << input.first << " " << standard << "/" << engine << "/" << stable << ";";
+        }
+        std::cout << std::endl;
+    }
+}
+
+void benchmarkSorts() {
+    std::cout << "Sort ns per element for std::sort / sort() / sort(true) with " << arraySort::hardwareThreads()
+              << " hardware threads" << std::endl;
+    auto identity = [](const auto& element) -> const auto& { return element; };
+    benchmarkSort<int32_t>("int32_t", [](uint64_t bits) { return static_cast<int32_t>(bits); }, identity);
+    benchmarkSort<uint64_t>("uint64_t", [](uint64_t bits) { return bits; }, identity);
+    benchmarkSort<double>("double", [](uint64_t bits) { return static_cast<double>(static_cast<int64_t>(bits)) / 1e9; }, identity);
+    benchmarkSort<SortRecord>("record by score",
+                              [](uint64_t bits) { return SortRecord{static_cast<uint32_t>(bits), static_cast<double>(bits % 1000003)}; },
+                              [](const SortRecord& record) { return record.score; });
+    benchmarkSort<std::string>("string", [](uint64_t bits) { return std::to_string(bits); }, identity);
+}
+
+bool isPipelineSample(int64_t element) {
+    return element % 3 != 0;
+}
+
+int64_t scalePipelineSample(int64_t element) {
+    return element * 7 + 1;
+}
+
+int64_t addPipelineSample(int64_t sum, int64_t element) {
+    return sum + element;
+}
+
+// A filter, map and reduce chain run the way the eager methods used to: a function pointer
+// per stage and a new vector after each one.
+int64_t eagerFilterMapReduce(const std::vector<int64_t>& elements, bool (*isIncluded)(int64_t),
+                             int64_t (*transform)(int64_t), int64_t (*reducer)(int64_t, int64_t)) {
+    std::vector<int64_t> filtered;
+    for (int64_t element : elements) {
+        if (isIncluded(element)) {
+            filtered.push_back(element);
+        }
+    }
+    std::vector<int64_t> mapped;
+    for (int64_t element : filtered) {
+        mapped.push_back(transform(element));
+    }
+    int64_t result = 0;
+    for (int64_t element : mapped) {
+        result = reducer(result, element);
+    }
+    return result;
+}
+
+// The same chain eagerly and as one fused pipeline() pass.
+void benchmarkPipelines() {
+    std::cout << "Filter, map and reduce, elements per ns (eager / pipeline)" << std::endl;
+    for (size_t elementCount : {1000, 100000, 10000000}) {
+        CustomArray<int64_t> customArray(0);
+        std::vector<int64_t> elements;
+        for (size_t i = 0; i < elementCount; ++i) {
+            customArray.append(static_cast<int64_t>(i));
+            elements.push_back(static_cast<int64_t>(i));
+        }
+        double eager = elementsPerNanosecond(elementCount, [&] {
+            return static_cast<size_t>(
+                eagerFilterMapReduce(elements, isPipelineSample, scalePipelineSample, addPipelineSample));
+        });
+        int64_t scale = 7;
+        double fused = elementsPerNanosecond(elementCount, [&] {
+            return static_cast<size_t>(customArray.pipeline()
+                                           .filter([](int64_t element) { return element % 3 != 0; })
+                                           .map([scale](int64_t element) { return element * scale + 1; })
+                                           .reduce(int64_t(0), [](int64_t sum, int64_t element) { return sum + element; }));
+        });
+        std::cout << "  n=" << elementCount << ": " << eager << " / " << fused << std::endl;
+    }
+}
+
+// Build, fill, query and drop two million arrays of elementCount ints; prints the time and
+// heap allocations per array.
+template <size_t InlineCapacity>
+void measureSmallArrays(const char* label, size_t elementCount) {
+    constexpr size_t arrayCount = 2000000;
+    size_t allocationsBefore = countedAllocations;
+    auto start = std::chrono::steady_clock::now();
+    size_t total = 0;
+    for (size_t i = 0; i < arrayCount; ++i) {
+        CustomArray<int, InlineCapacity, CountingAllocator<int>> customArray(0);
+        for (size_t j = 0; j < elementCount; ++j) {
+            customArray.append(static_cast<int>(i + j));
+        }
+        total += customArray.count(static_cast<int>(i)) + customArray.size();
+    }
+    double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    size_t allocations = countedAllocations - allocationsBefore;
+    benchmarkSink = total;
+    std::cout << " " << label << " " << nanoseconds / arrayCount << " ns, "
+              << static_cast<double>(allocations) / arrayCount << " allocations;";
+}
+
+void benchmarkSmallArrays() {
+    std::cout << "Short-lived small arrays, per array (std::vector storage vs InlineCapacity 16)" << std::endl;
+    for (size_t elementCount : {4, 12, 24}) {
+        std::cout << "  n=" << elementCount << ":";
+        measureSmallArrays<0>("vector", elementCount);
+        measureSmallArrays<16>("inline", elementCount);
+        std::cout << std::endl;
+    }
+}
+
+// Summing windows of a 1M-element array through slice() copies and through sliceView, and
+// 4096-element batches through slice() and chunks().
+void benchmarkViews() {
+    constexpr int elementCount = 1 << 20;
+    CustomArray<int64_t> customArray(0);
+    for (int i = 0; i < elementCount; ++i) {
+        customArray.append(i);
+    }
+    std::cout << "Window sums, elements per ns (slice / sliceView)" << std::endl;
+    for (int window : {16, 1024, 65536}) {
+        auto sumWindows = [&](auto sliceOf) {
+            int64_t total = 0;
+            for (int start = 0; start + window <= elementCount; start += window) {
+                auto slice = sliceOf(start, start + window - 1);
+                for (int64_t element : slice) {
+                    total += element;
+                }
+            }
+            return static_cast<size_t>(total);
+        };
+        double copied = elementsPerNanosecond(elementCount, [&] {
+            return sumWindows([&](int start, int end) { return customArray.slice(start, end); });
+        });
+        double viewed = elementsPerNanosecond(elementCount, [&] {
+            return sumWindows([&](int start, int end) { return customArray.sliceView(start, end); });
+        });
+        std::cout << "  window=" << window << ": " << copied << " / " << viewed << std::endl;
+    }
+    double copiedBatches = elementsPerNanosecond(elementCount, [&] {
+        int64_t total = 0;
+        for (int start = 0; start < elementCount; start += 4096) {
+            for (int64_t element : customArray.slice(start, std::min(start + 4096, elementCount) - 1)) {
+                total += element;
+            }
+        }
+        return static_cast<size_t>(total);
+    });
+    double chunkedBatches = elementsPerNanosecond(elementCount, [&] {
+        int64_t total = 0;
+        for (ArrayView<int64_t> chunk : customArray.chunks(4096)) {
+            for (int64_t element : chunk) {
+                total += element;
+            }
+        }
+        return static_cast<size_t>(total);
+    });
+    std::cout << "Batches of 4096, elements per ns (slice / chunks): " << copiedBatches << " / " << chunkedBatches
+              << std::endl;
+}
+
+int main(int argc, char* argv[]) {
     CustomArray<int> customArray(5);
     customArray.append(10);
     customArray.append(20);
@@ -162,6 +1450,18 @@ int main() {
     customArray.forEach([](int element) {
         std::cout << element << " ";
     });
+    std::cout << "\n";
+
+    std::cout << "Index of 15 or 20: " << customArray.indexOfAny({15, 20}) << "\n";
+    std::cout << "Elements in [10, 20]: " << customArray.countInRange(10, 20) << "\n";
+
+    if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+        benchmarkSearches();
+        benchmarkSorts();
+        benchmarkPipelines();
+        benchmarkSmallArrays();
+        benchmarkViews();
+    }
 
     return 0;
 }
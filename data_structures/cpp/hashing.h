@@ -0,0 +1,331 @@
+// Hashing shared by hashMaps.cpp and hashTables.cpp: heterogeneous string lookup, the
+// seeded FastHash default, the post-mixing applied to weaker hashers, the optional
+// statistics layer, and bounds checks for the snapshot files both can map.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Heterogeneous lookup: maps and tables keyed by std::string (with any allocator) or
+// std::string_view accept anything convertible to std::string_view in
+// getValue/contains/removeValue, so a lookup by literal or by a view into a larger buffer
+// never materializes a temporary string. Each of those methods also keeps a plain
+// `const Key&` overload, so other key types still accept arguments that merely convert to
+// the key (an int for a long key).
+template <typename Key>
+struct isCharString : std::is_same<Key, std::string_view> {};
+
+template <typename Allocator>
+struct isCharString<std::basic_string<char, std::char_traits<char>, Allocator>> : std::true_type {};
+
+template <typename Key>
+constexpr bool isStringKey = isCharString<Key>::value;
+
+template <typename Key, typename Lookup>
+using EnableIfLookupKey = std::enable_if_t<std::is_same<Key, Lookup>::value ||
+                                           (isStringKey<Key> && std::is_convertible<const Lookup&, std::string_view>::value)>;
+
+// std::hash<std::string_view> agrees with std::hash<std::string>, so both spellings of a
+// key land in the same bucket.
+template <typename Key, typename Lookup>
+size_t hashKey(const Lookup& key) {
+    if constexpr (isStringKey<Key>) {
+        return std::hash<std::string_view>{}(std::string_view(key));
+    } else {
+        return std::hash<Key>{}(key);
+    }
+}
+
+// Hashing
+//
+// Tables take a Hasher template parameter, defaulting to FastHash: wyhash-style mixing
+// seeded per instance, so which keys collide differs between tables and runs and cannot
+// be precomputed by whoever supplies the keys. Hashers that declare `is_avalanching`
+// are used as is; any other hasher (std::hash is the identity for integers) has its
+// output multiplied by 2^64 / phi, which spreads low-bit patterns into the high bits
+// that the bucket reduction reads.
+
+namespace hashing {
+
+inline uint64_t multiplyMix(uint64_t a, uint64_t b) {
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+}
+
+inline uint64_t read64(const char* bytes) {
+    uint64_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+inline uint64_t read32(const char* bytes) {
+    uint32_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+constexpr uint64_t secret0 = 0xA0761D6478BD642Full;
+constexpr uint64_t secret1 = 0xE7037ED1A0B428DBull;
+constexpr uint64_t golden = 0x9E3779B97F4A7C15ull;
+
+/// A different seed for every call: one random_device draw per process, then a counter.
+inline uint64_t nextSeed() {
+    static const uint64_t processSeed = (static_cast<uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}();
+    static std::atomic<uint64_t> counter{0};
+    return multiplyMix(processSeed ^ secret0, (counter.fetch_add(1, std::memory_order_relaxed) + 1) * golden);
+}
+
+/// Lemire's fastrange: map a well-mixed hash onto [0, range) with a multiply instead of `%`.
+inline size_t reduce(uint64_t hash, size_t range) {
+    return static_cast<size_t>((static_cast<unsigned __int128>(hash) * range) >> 64);
+}
+
+}  // namespace hashing
+
+template <typename Key>
+class FastHash {
+private:
+    uint64_t seed;
+
+    uint64_t hashBytes(std::string_view bytes) const {
+        const char* data = bytes.data();
+        size_t length = bytes.size();
+        uint64_t state = seed ^ hashing::multiplyMix(seed ^ hashing::secret0, hashing::secret1);
+        uint64_t a = 0;
+        uint64_t b = 0;
+        if (length <= 16) {
+            if (length >= 4) {
+                size_t middle = (length >> 3) << 2;
+                a = (hashing::read32(data) << 32) | hashing::read32(data + middle);
+                b = (hashing::read32(data + length - 4) << 32) | hashing::read32(data + length - 4 - middle);
+            } else if (length > 0) {
+                a = (static_cast<uint64_t>(static_cast<uint8_t>(data[0])) << 16) |
+                    (static_cast<uint64_t>(static_cast<uint8_t>(data[length >> 1])) << 8) |
+                    static_cast<uint8_t>(data[length - 1]);
+            }
+        } else {
+            size_t remaining = length;
+            for (; remaining > 16; remaining -= 16, data += 16) {
+                state = hashing::multiplyMix(hashing::read64(data) ^ hashing::secret1, hashing::read64(data + 8) ^ state);
+            }
+            a = hashing::read64(data + remaining - 16);
+            b = hashing::read64(data + remaining - 8);
+        }
+        return hashing::multiplyMix(hashing::secret1 ^ length,
+                                    hashing::multiplyMix(a ^ hashing::secret1, b ^ state));
+    }
+
+    uint64_t hashInteger(uint64_t value) const {
+        return hashing::multiplyMix(value ^ seed, hashing::golden ^ hashing::secret1);
+    }
+
+public:
+    using is_avalanching = void;
+
+    FastHash() : seed(hashing::nextSeed()) {}
+    explicit FastHash(uint64_t seed) : seed(seed) {}
+
+    template <typename K>
+    size_t operator()(const K& key) const {
+        if constexpr (isStringKey<Key>) {
+            return hashBytes(std::string_view(key));
+        } else if constexpr (std::is_integral<Key>::value || std::is_enum<Key>::value) {
+            return hashInteger(static_cast<uint64_t>(key));
+        } else if constexpr (std::is_pointer<Key>::value) {
+            return hashInteger(reinterpret_cast<uintptr_t>(key));
+        } else {
+            return hashInteger(std::hash<Key>{}(key));
+        }
+    }
+};
+
+template <typename Hasher, typename = void>
+struct isAvalanching : std::false_type {};
+
+template <typename Hasher>
+struct isAvalanching<Hasher, std::void_t<typename Hasher::is_avalanching>> : std::true_type {};
+
+/// Hash `key` with `hasher` for a table keyed by `Key`, post-mixing weak hashers.
+template <typename Key, typename Hasher, typename Lookup>
+uint64_t hashWith(const Hasher& hasher, const Lookup& key) {
+    uint64_t hash;
+    if constexpr (std::is_same<Hasher, std::hash<Key>>::value) {
+        hash = hashKey<Key>(key);
+    } else if constexpr (std::is_invocable<const Hasher&, const Lookup&>::value) {
+        hash = hasher(key);
+    } else {
+        // A hasher that only takes Key itself: heterogeneous lookups pay for a conversion.
+        hash = hasher(Key(key));
+    }
+    if constexpr (!isAvalanching<Hasher>::value) {
+        hash *= hashing::golden;
+    }
+    return hash;
+}
+
+// Statistics
+//
+// HashMap and HashTable take a Statistics policy as their last template parameter. The
+// default, NoStatistics, has no state and empty hooks that compile away, so uninstrumented
+// tables run exactly the code they would without the policy. HashStatistics records every
+// lookup and rehash; the table's statistics() call adds a scan of the current buckets
+// and returns the combined figures, which dump as text or JSON.
+
+struct NoStatistics {
+    static constexpr bool enabled = false;
+
+    void recordLookup(size_t, bool) {}
+    int startRehash() const {
+        return 0;
+    }
+    void finishRehash(int) {}
+};
+
+struct HashStatistics {
+    static constexpr bool enabled = true;
+
+    // Const lookups record through a shared reference, possibly from several readers at
+    // once (ConcurrentHashMap shards take a shared lock to read), so lookup counters are
+    // relaxed atomics. Rehashes only happen under exclusive access and stay plain.
+    struct Counter {
+        std::atomic<uint64_t> value{0};
+
+        Counter() = default;
+        Counter(const Counter& other) : value(other) {}
+        Counter& operator=(const Counter& other) {
+            value.store(other, std::memory_order_relaxed);
+            return *this;
+        }
+        void increment() {
+            value.fetch_add(1, std::memory_order_relaxed);
+        }
+        operator uint64_t() const {
+            return value.load(std::memory_order_relaxed);
+        }
+    };
+
+    // Lookups comparing at least this many keys share the last histogram slot.
+    static constexpr size_t longProbe = 31;
+
+    // Recorded as the table is used
+    Counter hits;
+    Counter misses;
+    std::array<Counter, longProbe + 1> probeLengthHistogram;  // lookups by number of keys compared
+    uint64_t rehashCount = 0;
+    double rehashSeconds = 0;
+    double longestRehashSeconds = 0;
+
+    // Filled in from the buckets by the table's statistics()
+    size_t bucketCount = 0;
+    size_t elementCount = 0;
+    std::vector<uint64_t> chainLengthHistogram;  // buckets by number of elements
+    size_t worstBucket = 0;
+    size_t worstBucketLength = 0;
+    double bytesPerBucket = 0;  // bucket headers plus their element storage, averaged
+
+    void recordLookup(size_t keysCompared, bool hit) {
+        (hit ? hits : misses).increment();
+        probeLengthHistogram[std::min(keysCompared, longProbe)].increment();
+    }
+
+    std::chrono::steady_clock::time_point startRehash() const {
+        return std::chrono::steady_clock::now();
+    }
+
+    void finishRehash(std::chrono::steady_clock::time_point start) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ++rehashCount;
+        rehashSeconds += seconds;
+        longestRehashSeconds = std::max(longestRehashSeconds, seconds);
+    }
+
+    void recordBucket(size_t index, size_t length) {
+        if (length >= chainLengthHistogram.size()) {
+            chainLengthHistogram.resize(length + 1);
+        }
+        ++chainLengthHistogram[length];
+        if (length > worstBucketLength) {
+            worstBucket = index;
+            worstBucketLength = length;
+        }
+    }
+
+    std::string toText() const {
+        std::ostringstream text;
+        text << "lookups: " << hits + misses << " (hits " << hits << ", misses " << misses << ")\n"
+             << "probe lengths:" << histogramText(probeLengthHistogram) << "\n"
+             << "rehashes: " << rehashCount << ", total " << rehashSeconds << " s, longest "
+             << longestRehashSeconds << " s\n"
+             << "buckets: " << bucketCount << ", elements " << elementCount << "\n"
+             << "chain lengths:" << histogramText(chainLengthHistogram) << "\n"
+             << "worst bucket: " << worstBucket << " (" << worstBucketLength << " elements)\n"
+             << "bytes per bucket: " << bytesPerBucket << "\n";
+        return text.str();
+    }
+
+    std::string toJson() const {
+        std::ostringstream json;
+        json << "{\"hits\":" << hits << ",\"misses\":" << misses
+             << ",\"probeLengthHistogram\":" << histogramJson(probeLengthHistogram)
+             << ",\"rehashCount\":" << rehashCount << ",\"rehashSeconds\":" << rehashSeconds
+             << ",\"longestRehashSeconds\":" << longestRehashSeconds << ",\"bucketCount\":" << bucketCount
+             << ",\"elementCount\":" << elementCount
+             << ",\"chainLengthHistogram\":" << histogramJson(chainLengthHistogram)
+             << ",\"worstBucket\":" << worstBucket << ",\"worstBucketLength\":" << worstBucketLength
+             << ",\"bytesPerBucket\":" << bytesPerBucket << "}";
+        return json.str();
+    }
+
+private:
+    // "length:count" for every non-empty slot.
+    template <typename Histogram>
+    static std::string histogramText(const Histogram& histogram) {
+        std::string text;
+        for (size_t value = 0; value < histogram.size(); ++value) {
+            uint64_t count = histogram[value];
+            if (count != 0) {
+                text += " " + std::to_string(value) + ":" + std::to_string(count);
+            }
+        }
+        return text;
+    }
+
+    // Slot i counts lookups or buckets of length i; trailing empty slots are left out.
+    template <typename Histogram>
+    static std::string histogramJson(const Histogram& histogram) {
+        size_t used = histogram.size();
+        while (used > 0 && histogram[used - 1] == 0) {
+            --used;
+        }
+        std::string json = "[";
+        for (size_t value = 0; value < used; ++value) {
+            json += (value == 0 ? "" : ",") + std::to_string(static_cast<uint64_t>(histogram[value]));
+        }
+        return json + "]";
+    }
+};
+
+// Snapshot Files
+
+/// End of a section of `count` items of `width` bytes starting at `offset`, or UINT64_MAX
+/// (never a valid file position) if the arithmetic overflows.
+inline uint64_t sectionEnd(uint64_t offset, uint64_t count, uint64_t width) {
+    uint64_t bytes = 0;
+    uint64_t end = 0;
+    if (__builtin_mul_overflow(count, width, &bytes) || __builtin_add_overflow(offset, bytes, &end)) {
+        return UINT64_MAX;
+    }
+    return end;
+}
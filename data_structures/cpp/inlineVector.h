@@ -0,0 +1,258 @@
+// Small-buffer vector shared by arrays.cpp and stacks.cpp.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Vector that keeps its first InlineCapacity elements inside the object and moves them to a
+// heap buffer only once it outgrows them. CustomArray and CustomStack store their elements
+// in one when given an InlineCapacity above zero; it offers the part of the std::vector
+// interface those containers use, with pointers as iterators, and takes its heap buffers
+// from Allocator.
+template <typename T, size_t InlineCapacity, typename Allocator = std::allocator<T>>
+class InlineVector {
+private:
+    alignas(T) unsigned char inlineSlots[InlineCapacity * sizeof(T)];
+    T* slots = reinterpret_cast<T*>(inlineSlots);  // inlineSlots, or a heap buffer after spilling
+    size_t count = 0;
+    size_t capacity = InlineCapacity;
+
+    bool isInline() const {
+        return slots == reinterpret_cast<const T*>(inlineSlots);
+    }
+
+    void releaseHeap() {
+        if (!isInline()) {
+            Allocator().deallocate(slots, capacity);
+        }
+    }
+
+    // Move the elements into a heap buffer with room for newCapacity elements.
+    void grow(size_t newCapacity) {
+        T* newSlots = Allocator().allocate(newCapacity);
+        try {
+            std::uninitialized_move(slots, slots + count, newSlots);
+        } catch (...) {
+            Allocator().deallocate(newSlots, newCapacity);
+            throw;
+        }
+        std::destroy(slots, slots + count);
+        releaseHeap();
+        slots = newSlots;
+        capacity = newCapacity;
+    }
+
+    // Take other's elements, stealing its heap buffer if it has one, and leave it empty.
+    void takeFrom(InlineVector& other) {
+        if (other.isInline()) {
+            std::uninitialized_move(other.slots, other.slots + other.count, slots);
+            count = other.count;
+            other.clear();
+        } else {
+            slots = other.slots;
+            count = other.count;
+            capacity = other.capacity;
+            other.slots = reinterpret_cast<T*>(other.inlineSlots);
+            other.count = 0;
+            other.capacity = InlineCapacity;
+        }
+    }
+
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    InlineVector() = default;
+
+    InlineVector(const InlineVector& other) {
+        reserve(other.count);
+        try {
+            std::uninitialized_copy(other.begin(), other.end(), slots);
+        } catch (...) {
+            releaseHeap();  // the destructor does not run for a constructor that throws
+            throw;
+        }
+        count = other.count;
+    }
+
+    InlineVector(InlineVector&& other) noexcept(std::is_nothrow_move_constructible<T>::value) {
+        takeFrom(other);
+    }
+
+    InlineVector& operator=(const InlineVector& other) {
+        if (this != &other) {
+            assign(other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    InlineVector& operator=(InlineVector&& other) noexcept(std::is_nothrow_move_constructible<T>::value) {
+        if (this != &other) {
+            clear();
+            releaseHeap();
+            slots = reinterpret_cast<T*>(inlineSlots);
+            capacity = InlineCapacity;
+            takeFrom(other);
+        }
+        return *this;
+    }
+
+    ~InlineVector() {
+        clear();
+        releaseHeap();
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    T* data() {
+        return slots;
+    }
+
+    const T* data() const {
+        return slots;
+    }
+
+    T* begin() {
+        return slots;
+    }
+
+    T* end() {
+        return slots + count;
+    }
+
+    const T* begin() const {
+        return slots;
+    }
+
+    const T* end() const {
+        return slots + count;
+    }
+
+    T& operator[](size_t index) {
+        return slots[index];
+    }
+
+    const T& operator[](size_t index) const {
+        return slots[index];
+    }
+
+    T& back() {
+        return slots[count - 1];
+    }
+
+    const T& back() const {
+        return slots[count - 1];
+    }
+
+    void reserve(size_t newCapacity) {
+        if (newCapacity > capacity) {
+            grow(newCapacity);
+        }
+    }
+
+    // The new element is built before growing, so it may be a copy of an existing one.
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (count == capacity) {
+            T element(std::forward<Args>(args)...);
+            grow(capacity * 2);
+            ::new (static_cast<void*>(slots + count)) T(std::move(element));
+        } else {
+            ::new (static_cast<void*>(slots + count)) T(std::forward<Args>(args)...);
+        }
+        return slots[count++];
+    }
+
+    void push_back(const T& element) {
+        emplace_back(element);
+    }
+
+    void push_back(T&& element) {
+        emplace_back(std::move(element));
+    }
+
+    void pop_back() {
+        slots[--count].~T();
+    }
+
+    T* insert(const T* position, const T& element) {
+        size_t index = position - slots;
+        emplace_back(element);
+        std::rotate(slots + index, slots + count - 1, slots + count);
+        return slots + index;
+    }
+
+    template <typename InputIterator>
+    T* insert(const T* position, InputIterator first, InputIterator last) {
+        size_t index = position - slots;
+        size_t oldCount = count;
+        if constexpr (std::is_base_of<std::forward_iterator_tag,
+                                      typename std::iterator_traits<InputIterator>::iterator_category>::value) {
+            size_t added = static_cast<size_t>(std::distance(first, last));
+            if (count + added > capacity) {
+                // Copy the new elements before the old buffer goes away: they may come from it.
+                size_t newCapacity = std::max(count + added, capacity * 2);
+                T* newSlots = Allocator().allocate(newCapacity);
+                try {
+                    std::uninitialized_copy(first, last, newSlots + count);
+                } catch (...) {
+                    Allocator().deallocate(newSlots, newCapacity);
+                    throw;
+                }
+                std::uninitialized_move(slots, slots + count, newSlots);
+                std::destroy(slots, slots + count);
+                releaseHeap();
+                slots = newSlots;
+                capacity = newCapacity;
+                count += added;
+                first = last;
+            }
+        }
+        for (; first != last; ++first) {
+            emplace_back(*first);
+        }
+        std::rotate(slots + index, slots + oldCount, slots + count);
+        return slots + index;
+    }
+
+    template <typename InputIterator>
+    void assign(InputIterator first, InputIterator last) {
+        clear();
+        insert(end(), first, last);
+    }
+
+    T* erase(const T* position) {
+        size_t index = position - slots;
+        std::move(slots + index + 1, slots + count, slots + index);
+        pop_back();
+        return slots + index;
+    }
+
+    void resize(size_t newCount) {
+        if (newCount < count) {
+            std::destroy(slots + newCount, slots + count);
+        } else {
+            reserve(newCount);
+            std::uninitialized_value_construct(slots + count, slots + newCount);
+        }
+        count = newCount;
+    }
+
+    void clear() {
+        std::destroy(slots, slots + count);
+        count = 0;
+    }
+};
@@ -0,0 +1,78 @@
+// Lazy element pipeline shared by arrays.cpp, stacks.cpp and queues.cpp.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Returned by the pipeline() of CustomArray, CustomStack and CustomQueue. A pipeline is a
+// source that pushes every element into a sink; map and filter wrap that source in another
+// one, so a chain of stages runs as one pass with no intermediate vectors, and the callables
+// (capturing lambdas included) are inlined into that loop. Nothing runs until forEach,
+// reduce or toVector. The pipeline refers to the container's elements, so it must not
+// outlive or be used across changes to the container.
+template <typename Element, typename Source>
+class Pipeline {
+private:
+    Source source;      // source(sink) calls sink(element) for every element, in order
+    size_t knownCount;  // Number of elements, or unknownCount once a filter stage is added
+
+public:
+    static constexpr size_t unknownCount = SIZE_MAX;
+
+    Pipeline(Source source, size_t knownCount) : source(std::move(source)), knownCount(knownCount) {}
+
+    // Stage that replaces each element with transform(element). Each run calls a fresh
+    // copy of transform, so a stateful (mutable) lambda starts from its captured state.
+    template <typename Transform>
+    auto map(Transform transform) const {
+        using Mapped = std::decay_t<std::invoke_result_t<Transform&, const Element&>>;
+        auto mappedSource = [source = source, transform](auto&& sink) {
+            Transform stage = transform;
+            source([&](const Element& element) { sink(stage(element)); });
+        };
+        return Pipeline<Mapped, decltype(mappedSource)>(std::move(mappedSource), knownCount);
+    }
+
+    // Stage that keeps only the elements for which predicate(element) is true, calling a
+    // fresh copy of predicate on each run.
+    template <typename Predicate>
+    auto filter(Predicate predicate) const {
+        auto filteredSource = [source = source, predicate](auto&& sink) {
+            Predicate stage = predicate;
+            source([&](auto&& element) {
+                if (stage(static_cast<const Element&>(element))) {
+                    sink(std::forward<decltype(element)>(element));
+                }
+            });
+        };
+        return Pipeline<Element, decltype(filteredSource)>(std::move(filteredSource), unknownCount);
+    }
+
+    // Call visit(element) for every element.
+    template <typename Visitor>
+    void forEach(Visitor visit) const {
+        source([&](const Element& element) { visit(element); });
+    }
+
+    // Fold the elements into initialResult with result = reducer(result, element).
+    template <typename Result, typename Reducer>
+    Result reduce(Result initialResult, Reducer reducer) const {
+        Result result = std::move(initialResult);
+        source([&](const Element& element) { result = reducer(std::move(result), element); });
+        return result;
+    }
+
+    // Collect the elements into a new vector.
+    std::vector<Element> toVector() const {
+        std::vector<Element> result;
+        if (knownCount != unknownCount) {
+            result.reserve(knownCount);
+        }
+        source([&](auto&& element) { result.push_back(std::forward<decltype(element)>(element)); });
+        return result;
+    }
+};
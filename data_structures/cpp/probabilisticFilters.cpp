@@ -0,0 +1,559 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "stableHashing.h"
+
+// Approximate membership filters that sit in front of an exact container. A filter answers
+// "definitely absent" or "possibly present": a negative answer is always right, and a
+// positive one is wrong with a small, configurable probability. When most lookups are
+// misses, asking the filter first keeps them away from the container entirely.
+
+// Serialization Helpers
+
+void expectMagic(const std::vector<uint8_t>& bytes, size_t& offset, uint32_t magic, const char* name) {
+    if (readBytes(bytes, offset, 4) != magic || readBytes(bytes, offset, 4) != 1) {
+        throw std::runtime_error(std::string("Not a version 1 ") + name + ".");
+    }
+}
+
+// Split-Block Bloom Filter
+
+// A Bloom filter whose bits for one key all land in a single 256-bit block: eight 32-bit
+// words, one bit set in each. A lookup therefore touches one cache line, and with AVX2 it
+// computes all eight bit positions and tests them against the block in a handful of
+// instructions. Keys cannot be removed.
+template <typename Key>
+class SplitBlockBloomFilter {
+private:
+    struct alignas(32) Block {
+        uint32_t words[8] = {};
+    };
+
+    static constexpr uint32_t magic = 0x46424253;  // "SBBF"
+    static constexpr uint32_t salts[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                          0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+    std::vector<Block> blocks;
+    bool useAvx2 = false;
+
+    explicit SplitBlockBloomFilter(std::vector<Block>&& loaded) : blocks(std::move(loaded)) {
+        useAvx2 = hasAvx2();
+    }
+
+    static bool hasAvx2() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+
+    size_t blockIndex(uint64_t hash) const {
+        return ((hash >> 32) * blocks.size()) >> 32;
+    }
+
+    // Bit i of the key's mask lives in word i, at the position picked by the top five bits
+    // of the low hash word times salt i.
+    static bool blockContains(const Block& block, uint32_t low) {
+        for (size_t i = 0; i < 8; ++i) {
+            if ((block.words[i] & (1u << ((low * salts[i]) >> 27))) == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // False-positive rate when blocks hold `keysPerBlock` keys on average. Block loads are
+    // Poisson-distributed, and a block holding k keys has each word bit set with
+    // probability 1 - (31/32)^k.
+    static double falsePositiveRateAt(double keysPerBlock) {
+        double rate = 0;
+        double limit = keysPerBlock + 10 * std::sqrt(keysPerBlock) + 10;
+        for (double k = 0; k <= limit; ++k) {
+            double probability = std::exp(k * std::log(keysPerBlock) - keysPerBlock - std::lgamma(k + 1));
+            rate += probability * std::pow(1 - std::pow(31.0 / 32, k), 8);
+        }
+        return rate;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    __attribute__((target("avx2"))) static bool blockContainsAvx2(const Block& block, uint32_t low) {
+        __m256i salt = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(salts));
+        __m256i positions = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(low), salt), 27);
+        __m256i mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), positions);
+        __m256i words = _mm256_load_si256(reinterpret_cast<const __m256i*>(block.words));
+        return _mm256_testc_si256(words, mask);
+    }
+#endif
+
+public:
+    /// Sized so that, holding `expectedKeys` keys, a lookup of an absent key comes back
+    /// positive with probability about `falsePositiveRate`.
+    SplitBlockBloomFilter(size_t expectedKeys, double falsePositiveRate) {
+        if (!(falsePositiveRate > 0 && falsePositiveRate < 1)) {
+            throw std::runtime_error("False-positive rate must lie strictly between 0 and 1.");
+        }
+        double low = 1e-6;
+        double high = 1e4;
+        for (int step = 0; step < 60; ++step) {
+            double middle = std::sqrt(low * high);
+            (falsePositiveRateAt(middle) > falsePositiveRate ? high : low) = middle;
+        }
+        blocks.resize(std::max<size_t>(1, static_cast<size_t>(std::ceil(std::max<size_t>(expectedKeys, 1) / low))));
+        useAvx2 = hasAvx2();
+    }
+
+    void insert(const Key& key) {
+        uint64_t hash = stableHash(key);
+        Block& block = blocks[blockIndex(hash)];
+        uint32_t low = static_cast<uint32_t>(hash);
+        for (size_t i = 0; i < 8; ++i) {
+            block.words[i] |= 1u << ((low * salts[i]) >> 27);
+        }
+    }
+
+    bool contains(const Key& key) const {
+        uint64_t hash = stableHash(key);
+#if defined(__x86_64__) || defined(__i386__)
+        if (useAvx2) {
+            return blockContainsAvx2(blocks[blockIndex(hash)], static_cast<uint32_t>(hash));
+        }
+#endif
+        return blockContains(blocks[blockIndex(hash)], static_cast<uint32_t>(hash));
+    }
+
+    /// Force the portable probe even where AVX2 is available (for comparison).
+    void setUsesSimd(bool enabled) {
+        useAvx2 = enabled && hasAvx2();
+    }
+
+    size_t sizeInBytes() const {
+        return blocks.size() * sizeof(Block);
+    }
+
+    // Serialization
+
+    std::vector<uint8_t> serialize() const {
+        std::vector<uint8_t> bytes;
+        bytes.reserve(16 + sizeInBytes());
+        appendBytes(bytes, magic, 4);
+        appendBytes(bytes, 1, 4);
+        appendBytes(bytes, blocks.size(), 8);
+        for (const Block& block : blocks) {
+            for (uint32_t word : block.words) {
+                appendBytes(bytes, word, 4);
+            }
+        }
+        return bytes;
+    }
+
+    static SplitBlockBloomFilter deserialize(const std::vector<uint8_t>& bytes) {
+        size_t offset = 0;
+        expectMagic(bytes, offset, magic, "split-block Bloom filter");
+        uint64_t blockCount = readBytes(bytes, offset, 8);
+        if (blockCount == 0 || blockCount != (bytes.size() - offset) / sizeof(Block) ||
+            (bytes.size() - offset) % sizeof(Block) != 0) {
+            throw std::runtime_error("Split-block Bloom filter size does not match its header.");
+        }
+        std::vector<Block> loaded(blockCount);
+        for (Block& block : loaded) {
+            for (uint32_t& word : block.words) {
+                word = static_cast<uint32_t>(readBytes(bytes, offset, 4));
+            }
+        }
+        return SplitBlockBloomFilter(std::move(loaded));
+    }
+};
+
+// Cuckoo Filter
+
+// Stores a short fingerprint of each key in one of two four-slot buckets; the second bucket
+// is derived from the first and the fingerprint alone, so a stored fingerprint can be moved
+// between its buckets without the key. Unlike a Bloom filter it supports remove(). A miss
+// compares against the 8 slots of two buckets, so the false-positive rate is about
+// 8 * load / 2^bits of the fingerprint: at most ~3% for uint8_t and ~0.012% for uint16_t
+// with every slot full, and ~1.6% and ~0.006% at the half load the benchmark's 4M keys
+// reach once the bucket count is rounded up to a power of two. A key inserted n times
+// must be removed n times.
+template <typename Key, typename Fingerprint = uint16_t>
+class CuckooFilter {
+    static_assert(std::is_unsigned<Fingerprint>::value, "Fingerprints are unsigned integers");
+
+private:
+    static constexpr size_t slotsPerBucket = 4;
+    static constexpr size_t maxKicks = 500;
+    static constexpr uint32_t magic = 0x4f4f4b43;  // "CKOO"
+
+    std::vector<Fingerprint> slots;  // bucket b is slots[4b .. 4b + 3]; 0 marks an empty slot
+    size_t bucketMask = 0;
+    size_t itemCount = 0;
+    uint64_t randomState = 0x9e3779b97f4a7c15ULL;
+
+    // A fingerprint evicted by a failed insert: still a member, but the filter is full.
+    bool hasVictim = false;
+    size_t victimBucket = 0;
+    Fingerprint victimFingerprint = 0;
+
+    CuckooFilter() = default;
+
+    static Fingerprint fingerprintOf(uint64_t hash) {
+        Fingerprint fingerprint = static_cast<Fingerprint>(hash >> 32);
+        return fingerprint == 0 ? 1 : fingerprint;
+    }
+
+    size_t alternate(size_t bucket, Fingerprint fingerprint) const {
+        return (bucket ^ stableHashing::mix(fingerprint)) & bucketMask;
+    }
+
+    bool bucketHas(size_t bucket, Fingerprint fingerprint) const {
+        const Fingerprint* slot = &slots[bucket * slotsPerBucket];
+        return slot[0] == fingerprint || slot[1] == fingerprint || slot[2] == fingerprint || slot[3] == fingerprint;
+    }
+
+    bool store(size_t bucket, Fingerprint fingerprint) {
+        for (size_t i = 0; i < slotsPerBucket; ++i) {
+            Fingerprint& slot = slots[bucket * slotsPerBucket + i];
+            if (slot == 0) {
+                slot = fingerprint;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool erase(size_t bucket, Fingerprint fingerprint) {
+        for (size_t i = 0; i < slotsPerBucket; ++i) {
+            Fingerprint& slot = slots[bucket * slotsPerBucket + i];
+            if (slot == fingerprint) {
+                slot = 0;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint64_t nextRandom() {
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 7;
+        randomState ^= randomState << 17;
+        return randomState;
+    }
+
+public:
+    /// Room for about `capacity` keys (buckets fill to ~95% before inserts start failing).
+    explicit CuckooFilter(size_t capacity) {
+        size_t bucketCount = 1;
+        while (bucketCount * slotsPerBucket * 0.95 < capacity) {
+            bucketCount *= 2;
+        }
+        slots.assign(bucketCount * slotsPerBucket, 0);
+        bucketMask = bucketCount - 1;
+    }
+
+    /// False once the filter is full; the key is then not added.
+    bool insert(const Key& key) {
+        if (hasVictim) {
+            return false;
+        }
+        uint64_t hash = stableHash(key);
+        Fingerprint fingerprint = fingerprintOf(hash);
+        size_t bucket = hash & bucketMask;
+        ++itemCount;
+        if (store(bucket, fingerprint) || store(alternate(bucket, fingerprint), fingerprint)) {
+            return true;
+        }
+        if (nextRandom() & 1) {
+            bucket = alternate(bucket, fingerprint);
+        }
+        for (size_t kick = 0; kick < maxKicks; ++kick) {
+            std::swap(fingerprint, slots[bucket * slotsPerBucket + nextRandom() % slotsPerBucket]);
+            bucket = alternate(bucket, fingerprint);
+            if (store(bucket, fingerprint)) {
+                return true;
+            }
+        }
+        hasVictim = true;
+        victimBucket = bucket;
+        victimFingerprint = fingerprint;
+        return true;
+    }
+
+    bool contains(const Key& key) const {
+        uint64_t hash = stableHash(key);
+        Fingerprint fingerprint = fingerprintOf(hash);
+        size_t bucket = hash & bucketMask;
+        size_t other = alternate(bucket, fingerprint);
+        return bucketHas(bucket, fingerprint) || bucketHas(other, fingerprint) ||
+               (hasVictim && victimFingerprint == fingerprint && (victimBucket == bucket || victimBucket == other));
+    }
+
+    /// Removes one copy of `key`. Only call it for keys that were inserted, or it may
+    /// remove another key's fingerprint.
+    bool remove(const Key& key) {
+        uint64_t hash = stableHash(key);
+        Fingerprint fingerprint = fingerprintOf(hash);
+        size_t bucket = hash & bucketMask;
+        size_t other = alternate(bucket, fingerprint);
+        if (erase(bucket, fingerprint) || erase(other, fingerprint)) {
+            --itemCount;
+            if (hasVictim && (store(victimBucket, victimFingerprint) ||
+                              store(alternate(victimBucket, victimFingerprint), victimFingerprint))) {
+                hasVictim = false;
+            }
+            return true;
+        }
+        if (hasVictim && victimFingerprint == fingerprint && (victimBucket == bucket || victimBucket == other)) {
+            hasVictim = false;
+            --itemCount;
+            return true;
+        }
+        return false;
+    }
+
+    int count() const {
+        return itemCount;
+    }
+
+    double loadFactor() const {
+        return static_cast<double>(itemCount) / slots.size();
+    }
+
+    size_t sizeInBytes() const {
+        return slots.size() * sizeof(Fingerprint);
+    }
+
+    // Serialization
+
+    std::vector<uint8_t> serialize() const {
+        std::vector<uint8_t> bytes;
+        bytes.reserve(48 + sizeInBytes());
+        appendBytes(bytes, magic, 4);
+        appendBytes(bytes, 1, 4);
+        appendBytes(bytes, sizeof(Fingerprint), 1);
+        appendBytes(bytes, bucketMask + 1, 8);
+        appendBytes(bytes, itemCount, 8);
+        appendBytes(bytes, hasVictim, 1);
+        appendBytes(bytes, victimBucket, 8);
+        appendBytes(bytes, victimFingerprint, sizeof(Fingerprint));
+        for (Fingerprint slot : slots) {
+            appendBytes(bytes, slot, sizeof(Fingerprint));
+        }
+        return bytes;
+    }
+
+    static CuckooFilter deserialize(const std::vector<uint8_t>& bytes) {
+        size_t offset = 0;
+        expectMagic(bytes, offset, magic, "cuckoo filter");
+        if (readBytes(bytes, offset, 1) != sizeof(Fingerprint)) {
+            throw std::runtime_error("Cuckoo filter fingerprint width does not match.");
+        }
+        CuckooFilter filter;
+        uint64_t bucketCount = readBytes(bytes, offset, 8);
+        filter.itemCount = readBytes(bytes, offset, 8);
+        filter.hasVictim = readBytes(bytes, offset, 1) != 0;
+        filter.victimBucket = readBytes(bytes, offset, 8);
+        filter.victimFingerprint = static_cast<Fingerprint>(readBytes(bytes, offset, sizeof(Fingerprint)));
+        if (bucketCount == 0 || (bucketCount & (bucketCount - 1)) != 0 ||
+            (bytes.size() - offset) / sizeof(Fingerprint) / slotsPerBucket != bucketCount ||
+            (bytes.size() - offset) % (sizeof(Fingerprint) * slotsPerBucket) != 0 ||
+            filter.victimBucket >= bucketCount) {
+            throw std::runtime_error("Cuckoo filter size does not match its header.");
+        }
+        filter.bucketMask = bucketCount - 1;
+        filter.slots.resize(bucketCount * slotsPerBucket);
+        for (Fingerprint& slot : filter.slots) {
+            slot = static_cast<Fingerprint>(readBytes(bytes, offset, sizeof(Fingerprint)));
+        }
+        return filter;
+    }
+};
+
+// Filtered Container
+
+/// A membership front for any container with contains(key), such as CustomSet or HashMap.
+/// Lookups the filter rejects never reach the container. The container is referenced, not
+/// owned: report its inserts (and, with a CuckooFilter, its removals) through
+/// recordInsert/recordRemove so the filter never rejects a member.
+template <typename Container, typename Filter>
+class FilteredContainer {
+private:
+    const Container& container;
+    Filter filter;
+    mutable size_t lookups = 0;
+    mutable size_t rejections = 0;
+
+public:
+    FilteredContainer(const Container& container, Filter filter) : container(container), filter(std::move(filter)) {}
+
+    template <typename Key>
+    void recordInsert(const Key& key) {
+        filter.insert(key);
+    }
+
+    template <typename Keys>
+    void recordInsertAll(const Keys& keys) {
+        for (const auto& key : keys) {
+            filter.insert(key);
+        }
+    }
+
+    template <typename Key>
+    void recordRemove(const Key& key) {
+        filter.remove(key);
+    }
+
+    template <typename Key>
+    bool contains(const Key& key) const {
+        ++lookups;
+        if (!filter.contains(key)) {
+            ++rejections;
+            return false;
+        }
+        return container.contains(key);
+    }
+
+    /// Share of lookups answered by the filter alone.
+    double rejectionRate() const {
+        return lookups == 0 ? 0 : static_cast<double>(rejections) / lookups;
+    }
+
+    const Filter& membershipFilter() const {
+        return filter;
+    }
+};
+
+// Benchmark
+
+// Written by benchmarks so the optimizer cannot drop the measured loops.
+volatile size_t benchmarkSink = 0;
+
+// Stands in for a large CustomSet: the same node-based hash table, far bigger than cache.
+struct LargeSet {
+    std::unordered_map<uint64_t, bool> elements;
+
+    bool contains(uint64_t key) const {
+        return elements.find(key) != elements.end();
+    }
+};
+
+template <typename Set>
+double lookupsPerMicrosecond(const Set& set, const std::vector<uint64_t>& probes) {
+    auto start = std::chrono::steady_clock::now();
+    size_t found = 0;
+    for (uint64_t probe : probes) {
+        found += set.contains(probe);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    benchmarkSink = found;
+    return probes.size() / std::chrono::duration<double, std::micro>(elapsed).count();
+}
+
+template <typename Filter>
+double falsePositiveRate(const Filter& filter, const std::vector<uint64_t>& absentKeys) {
+    size_t positives = 0;
+    for (uint64_t key : absentKeys) {
+        positives += filter.contains(key);
+    }
+    return static_cast<double>(positives) / absentKeys.size();
+}
+
+void benchmarkFilters() {
+    // 4M members (even numbers); probes are 99% or 90% misses (odd numbers).
+    const size_t memberCount = 4 << 20;
+    const size_t probeCount = 4 << 20;
+    std::mt19937_64 random(11);
+    LargeSet set;
+    set.elements.reserve(memberCount);
+    std::vector<uint64_t> members(memberCount);
+    for (uint64_t& member : members) {
+        member = random() & ~uint64_t(1);
+        set.elements.emplace(member, true);
+    }
+    std::vector<uint64_t> absentKeys(probeCount);
+    for (uint64_t& key : absentKeys) {
+        key = random() | 1;
+    }
+
+    SplitBlockBloomFilter<uint64_t> bloom1(memberCount, 0.01);
+    SplitBlockBloomFilter<uint64_t> bloom01(memberCount, 0.001);
+    CuckooFilter<uint64_t, uint8_t> cuckoo8(memberCount);
+    CuckooFilter<uint64_t, uint16_t> cuckoo16(memberCount);
+    for (uint64_t member : members) {
+        bloom1.insert(member);
+        bloom01.insert(member);
+        cuckoo8.insert(member);
+        cuckoo16.insert(member);
+    }
+
+    std::cout << "Filters over 4M keys: bits per key, measured false-positive rate" << std::endl;
+    std::cout << "  Bloom 1%: " << 8.0 * bloom1.sizeInBytes() / memberCount << ", "
+              << falsePositiveRate(bloom1, absentKeys) << std::endl;
+    std::cout << "  Bloom 0.1%: " << 8.0 * bloom01.sizeInBytes() / memberCount << ", "
+              << falsePositiveRate(bloom01, absentKeys) << std::endl;
+    std::cout << "  Cuckoo uint8_t: " << 8.0 * cuckoo8.sizeInBytes() / memberCount << ", "
+              << falsePositiveRate(cuckoo8, absentKeys) << std::endl;
+    std::cout << "  Cuckoo uint16_t: " << 8.0 * cuckoo16.sizeInBytes() / memberCount << ", "
+              << falsePositiveRate(cuckoo16, absentKeys) << std::endl;
+
+    SplitBlockBloomFilter<uint64_t> scalarBloom = bloom1;
+    scalarBloom.setUsesSimd(false);
+    std::cout << "Bloom probe, million lookups/s: AVX2 " << lookupsPerMicrosecond(bloom1, absentKeys)
+              << ", scalar " << lookupsPerMicrosecond(scalarBloom, absentKeys) << std::endl;
+
+    for (double missShare : {0.99, 0.9}) {
+        std::vector<uint64_t> probes(probeCount);
+        for (uint64_t& probe : probes) {
+            probe = random() % 1000 < missShare * 1000 ? random() | 1 : members[random() % memberCount];
+        }
+        FilteredContainer<LargeSet, SplitBlockBloomFilter<uint64_t>> bloomFront(set, bloom1);
+        FilteredContainer<LargeSet, CuckooFilter<uint64_t, uint16_t>> cuckooFront(set, cuckoo16);
+        std::cout << "Lookups with " << missShare * 100 << "% misses, million/s: set alone "
+                  << lookupsPerMicrosecond(set, probes) << ", Bloom 1% front "
+                  << lookupsPerMicrosecond(bloomFront, probes) << ", cuckoo uint16_t front "
+                  << lookupsPerMicrosecond(cuckooFront, probes) << std::endl;
+    }
+}
+
+// Example usage
+int main(int argc, char* argv[]) {
+    std::unordered_map<std::string, int> ages = {{"alice", 31}, {"bob", 27}};
+    struct AgeTable {
+        const std::unordered_map<std::string, int>& ages;
+        bool contains(const std::string& name) const {
+            return ages.count(name) > 0;
+        }
+    } table{ages};
+
+    FilteredContainer<AgeTable, CuckooFilter<std::string>> front(table, CuckooFilter<std::string>(100));
+    front.recordInsert(std::string("alice"));
+    front.recordInsert(std::string("bob"));
+    std::cout << "Contains alice: " << front.contains(std::string("alice")) << std::endl;
+    std::cout << "Contains carol: " << front.contains(std::string("carol")) << std::endl;
+
+    SplitBlockBloomFilter<int> bloom(1000, 0.01);
+    for (int i = 0; i < 1000; i += 2) {
+        bloom.insert(i);
+    }
+    SplitBlockBloomFilter<int> restored = SplitBlockBloomFilter<int>::deserialize(bloom.serialize());
+    std::cout << "Restored Bloom filter contains 42: " << restored.contains(42)
+              << ", size " << restored.sizeInBytes() << " bytes" << std::endl;
+
+    if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+        benchmarkFilters();
+    }
+
+    return 0;
+}
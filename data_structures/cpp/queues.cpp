@@ -1,70 +1,240 @@
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "pipeline.h"
 
 template <typename T>
 class CustomQueue {
 private:
-    std::vector<T> elements;
+    // Elements live in a power-of-two ring buffer: the front is at `head` and the
+    // queue occupies `length` consecutive slots, wrapping around at `capacity`.
+    T* slots = nullptr;
+    size_t capacity = 0;
+    size_t head = 0;
+    size_t length = 0;
+
+    static constexpr size_t minimumCapacity = 8;
+    static constexpr bool isTriviallyCopyable = std::is_trivially_copyable<T>::value;
+
+    size_t slotIndex(size_t offset) const {
+        return (head + offset) & (capacity - 1);
+    }
+
+    /// Call `visit(pointer, count)` for the (at most two) contiguous runs of slots
+    /// that hold the `count` elements starting `offset` places behind the front.
+    template <typename Visitor>
+    void forEachSegment(size_t offset, size_t count, Visitor visit) const {
+        if (count == 0) {
+            return;
+        }
+        size_t start = slotIndex(offset);
+        size_t firstCount = std::min(count, capacity - start);
+        visit(slots + start, firstCount);
+        if (firstCount < count) {
+            visit(slots, count - firstCount);
+        }
+    }
+
+    /// Copy-construct `count` elements from `source` into raw memory at `destination`.
+    static void copySlots(const T* source, size_t count, T* destination) {
+        if constexpr (isTriviallyCopyable) {
+            std::memcpy(static_cast<void*>(destination), source, count * sizeof(T));
+        } else {
+            std::uninitialized_copy(source, source + count, destination);
+        }
+    }
+
+    /// Move `count` elements from `source` into raw memory at `destination` and
+    /// destroy the moved-from originals.
+    static void relocateSlots(T* source, size_t count, T* destination) {
+        if constexpr (isTriviallyCopyable) {
+            std::memcpy(static_cast<void*>(destination), source, count * sizeof(T));
+        } else {
+            std::uninitialized_move(source, source + count, destination);
+            std::destroy(source, source + count);
+        }
+    }
+
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = minimumCapacity;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    /// Drop `count` elements from the front without returning them.
+    void discardFront(size_t count) {
+        if constexpr (!std::is_trivially_destructible<T>::value) {
+            forEachSegment(0, count, [](T* segment, size_t segmentCount) {
+                std::destroy(segment, segment + segmentCount);
+            });
+        }
+        head = slotIndex(count);
+        length -= count;
+        if (length == 0) {
+            head = 0;  // Keep an empty queue contiguous so the next bulk copy is a single run.
+        }
+    }
+
+    void releaseStorage() {
+        discardFront(length);
+        if (slots != nullptr) {
+            std::allocator<T>().deallocate(slots, capacity);
+        }
+        slots = nullptr;
+        capacity = 0;
+    }
 
 public:
+    CustomQueue() = default;
+
+    CustomQueue(const CustomQueue<T>& otherQueue) {
+        reserve(otherQueue.length);
+        otherQueue.forEachSegment(0, otherQueue.length, [this](const T* segment, size_t segmentCount) {
+            copySlots(segment, segmentCount, slots + length);
+            length += segmentCount;
+        });
+    }
+
+    CustomQueue(CustomQueue<T>&& otherQueue) noexcept
+        : slots(otherQueue.slots), capacity(otherQueue.capacity), head(otherQueue.head), length(otherQueue.length) {
+        otherQueue.slots = nullptr;
+        otherQueue.capacity = 0;
+        otherQueue.head = 0;
+        otherQueue.length = 0;
+    }
+
+    CustomQueue<T>& operator=(CustomQueue<T> otherQueue) noexcept {
+        std::swap(slots, otherQueue.slots);
+        std::swap(capacity, otherQueue.capacity);
+        std::swap(head, otherQueue.head);
+        std::swap(length, otherQueue.length);
+        return *this;
+    }
+
+    ~CustomQueue() {
+        releaseStorage();
+    }
+
     // MARK: - Queue Operations
 
     /// Enqueue an element to the back of the queue.
     void enqueue(T element) {
-        elements.push_back(element);
+        if (length == capacity) {
+            reserve(length + 1);
+        }
+        new (slots + slotIndex(length)) T(std::move(element));
+        ++length;
     }
 
     /// Dequeue an element from the front of the queue.
     T dequeue() {
-        if (elements.empty()) {
+        if (length == 0) {
             throw std::out_of_range("Queue is empty.");
         }
-        T frontElement = elements.front();
-        elements.erase(elements.begin());
+        T frontElement = std::move(slots[head]);
+        discardFront(1);
         return frontElement;
     }
 
     /// Peek at the front element in the queue without dequeuing.
     T peek() const {
-        if (elements.empty()) {
+        if (length == 0) {
             throw std::out_of_range("Queue is empty.");
         }
-        return elements.front();
+        return slots[head];
     }
 
     /// Check if the queue is empty.
     bool isEmpty() const {
-        return elements.empty();
+        return length == 0;
     }
 
     /// Get the number of elements in the queue.
     int count() const {
-        return elements.size();
+        return length;
+    }
+
+    // MARK: - Capacity
+
+    /// Make room for at least `minimumCount` elements without further allocation.
+    /// Capacity is always a power of two and grows by doubling.
+    void reserve(size_t minimumCount) {
+        if (minimumCount <= capacity) {
+            return;
+        }
+        size_t newCapacity = roundUpToPowerOfTwo(std::max(minimumCount, capacity * 2));
+        T* newSlots = std::allocator<T>().allocate(newCapacity);
+        size_t moved = 0;
+        forEachSegment(0, length, [&moved, newSlots](T* segment, size_t segmentCount) {
+            relocateSlots(segment, segmentCount, newSlots + moved);
+            moved += segmentCount;
+        });
+        if (slots != nullptr) {
+            std::allocator<T>().deallocate(slots, capacity);
+        }
+        slots = newSlots;
+        capacity = newCapacity;
+        head = 0;
     }
 
     // MARK: - Queue Operations with Array
 
     /// Initialize the queue with an array of elements.
     void initializeWithArray(std::vector<T> array) {
-        elements = array;
+        clear();
+        enqueueArray(array);
     }
 
     /// Enqueue an array of elements to the back of the queue.
     void enqueueArray(const std::vector<T>& array) {
-        elements.insert(elements.end(), array.begin(), array.end());
+        if (array.empty()) {
+            return;
+        }
+        reserve(length + array.size());
+        size_t tail = slotIndex(length);
+        size_t firstCount = std::min(array.size(), capacity - tail);
+        copySlots(array.data(), firstCount, slots + tail);
+        copySlots(array.data() + firstCount, array.size() - firstCount, slots);
+        length += array.size();
     }
 
     /// Dequeue an array of elements from the front of the queue.
     std::vector<T> dequeueArray(int count) {
-        if (count < 0 || count > elements.size()) {
+        if (count < 0 || static_cast<size_t>(count) > length) {
             throw std::out_of_range("Invalid count for dequeueArray.");
         }
 
         std::vector<T> dequeuedElements;
-        for (int i = 0; i < count; ++i) {
-            dequeuedElements.push_back(elements.front());
-            elements.erase(elements.begin());
+        if constexpr (isTriviallyCopyable && std::is_default_constructible<T>::value) {
+            dequeuedElements.resize(count);
+            size_t copied = 0;
+            forEachSegment(0, count, [&copied, &dequeuedElements](const T* segment, size_t segmentCount) {
+                std::memcpy(static_cast<void*>(dequeuedElements.data() + copied), segment, segmentCount * sizeof(T));
+                copied += segmentCount;
+            });
+        } else {
+            dequeuedElements.reserve(count);
+            forEachSegment(0, count, [&dequeuedElements](T* segment, size_t segmentCount) {
+                std::move(segment, segment + segmentCount, std::back_inserter(dequeuedElements));
+            });
         }
+        discardFront(count);
         return dequeuedElements;
     }
 
@@ -72,73 +242,101 @@ public:
 
     /// Remove all elements from the queue.
     void clear() {
-        elements.clear();
+        discardFront(length);
     }
 
     // MARK: - Checking for Element
 
     /// Check if the queue contains a specific element.
     bool contains(T element) const {
-        return std::find(elements.begin(), elements.end(), element) != elements.end();
+        bool found = false;
+        forEachSegment(0, length, [&found, &element](const T* segment, size_t segmentCount) {
+            found = found || std::find(segment, segment + segmentCount, element) != segment + segmentCount;
+        });
+        return found;
+    }
+
+    // MARK: - Pipeline
+
+    /// Lazy pipeline over the elements from front to back; chained map and filter
+    /// stages run as a single pass over the ring buffer's segments.
+    auto pipeline() const {
+        auto source = [this](auto&& sink) {
+            forEachSegment(0, length, [&sink](const T* segment, size_t segmentCount) {
+                for (size_t i = 0; i < segmentCount; ++i) {
+                    sink(segment[i]);
+                }
+            });
+        };
+        return Pipeline<T, decltype(source)>(source, length);
     }
 
     // MARK: - Filtering
 
     /// Filter the queue using a given predicate.
-    std::vector<T> filter(bool (*predicate)(T)) const {
-        std::vector<T> filtered;
-        for (const T& element : elements) {
-            if (predicate(element)) {
-                filtered.push_back(element);
-            }
-        }
-        return filtered;
+    template <typename Predicate>
+    std::vector<T> filter(Predicate predicate) const {
+        return pipeline().filter(predicate).toVector();
     }
 
     // MARK: - Conversion to Vector
 
     /// Convert the queue to a vector.
     std::vector<T> toVector() const {
-        return elements;
+        std::vector<T> vector;
+        vector.reserve(length);
+        forEachSegment(0, length, [&vector](const T* segment, size_t segmentCount) {
+            vector.insert(vector.end(), segment, segment + segmentCount);
+        });
+        return vector;
     }
 
     // MARK: - Map
 
     /// Transform each element in the queue using a provided transform function.
+    template <typename Transform>
+    auto map(Transform transform) const {
+        return pipeline().map(transform).toVector();
+    }
+
+    /// Overload for explicit map<U>(transform) calls, which predate map taking any callable.
     template <typename U>
     std::vector<U> map(U (*transform)(T)) const {
-        std::vector<U> mapped;
-        for (const T& element : elements) {
-            mapped.push_back(transform(element));
-        }
-        return mapped;
+        return pipeline().map(transform).toVector();
     }
 
     // MARK: - Reduce
 
     /// Combine all elements in the queue using a reducer function.
-    template <typename Result>
-    Result reduce(Result initialResult, Result (*reducer)(Result, T)) const {
-        Result result = initialResult;
-        for (const T& element : elements) {
-            result = reducer(result, element);
-        }
-        return result;
+    template <typename Result, typename Reducer>
+    Result reduce(Result initialResult, Reducer reducer) const {
+        return pipeline().reduce(std::move(initialResult), reducer);
     }
 
     // MARK: - Concatenate
 
     /// Concatenate another queue to this queue.
     void concatenate(const CustomQueue<T>& otherQueue) {
-        elements.insert(elements.end(), otherQueue.elements.begin(), otherQueue.elements.end());
+        if (&otherQueue == this) {
+            enqueueArray(toVector());
+            return;
+        }
+        reserve(length + otherQueue.length);
+        otherQueue.forEachSegment(0, otherQueue.length, [this](const T* segment, size_t segmentCount) {
+            size_t tail = slotIndex(length);
+            size_t firstCount = std::min(segmentCount, capacity - tail);
+            copySlots(segment, firstCount, slots + tail);
+            copySlots(segment + firstCount, segmentCount - firstCount, slots);
+            length += segmentCount;
+        });
     }
 
     // MARK: - Subscript
 
     /// Access the element at a specific index in the queue.
     T operator[](int index) const {
-        if (index >= 0 && index < elements.size()) {
-            return elements[index];
+        if (index >= 0 && static_cast<size_t>(index) < length) {
+            return slots[slotIndex(index)];
         }
         throw std::out_of_range("Index out of range.");
     }
@@ -146,7 +344,638 @@ public:
     // ... Add more queue operations as needed ...
 };
 
-int main() {
+// MARK: - Single-Producer/Single-Consumer Queue
+
+/// Assumed size of a cache line; indices written by different threads are kept
+/// this far apart so the producer and consumer never invalidate each other's line.
+constexpr size_t cacheLineSize = 64;
+
+/// A bounded, lock-free queue for exactly one producer thread and one consumer thread.
+/// Only the producer may call the enqueue operations and only the consumer may call
+/// the dequeue operations.
+template <typename T>
+class SpscQueue {
+private:
+    std::vector<T> slots;
+    size_t mask;
+
+    // Consumer side: the next index to read, plus the last tail the consumer saw so it
+    // only touches the producer's cache line when it appears to have run out of items.
+    alignas(cacheLineSize) std::atomic<size_t> head{0};
+    size_t cachedTail = 0;
+
+    // Producer side: the next index to write, plus the last head the producer saw.
+    alignas(cacheLineSize) std::atomic<size_t> tail{0};
+    size_t cachedHead = 0;
+
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    /// Number of free slots as seen by the producer, refreshing the cached head only
+    /// when the cached value says there is not enough room.
+    size_t freeSlots(size_t currentTail, size_t wanted) {
+        size_t free = slots.size() - (currentTail - cachedHead);
+        if (free < wanted) {
+            cachedHead = head.load(std::memory_order_acquire);
+            free = slots.size() - (currentTail - cachedHead);
+        }
+        return free;
+    }
+
+    /// Number of readable items as seen by the consumer, refreshing the cached tail
+    /// only when the cached value says there are not enough items.
+    size_t readableSlots(size_t currentHead, size_t wanted) {
+        size_t available = cachedTail - currentHead;
+        if (available < wanted) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            available = cachedTail - currentHead;
+        }
+        return available;
+    }
+
+public:
+    /// Create a queue holding at most `capacity` elements (rounded up to a power of two).
+    explicit SpscQueue(size_t capacity)
+        : slots(roundUpToPowerOfTwo(std::max<size_t>(capacity, 2))), mask(slots.size() - 1) {}
+
+    SpscQueue(const SpscQueue<T>&) = delete;
+    SpscQueue<T>& operator=(const SpscQueue<T>&) = delete;
+
+    // MARK: - Queue Operations
+
+    /// Enqueue an element to the back of the queue. Returns false if the queue is full.
+    bool enqueue(T element) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (freeSlots(currentTail, 1) == 0) {
+            return false;
+        }
+        slots[currentTail & mask] = std::move(element);
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Dequeue an element from the front of the queue, or nothing if the queue is empty.
+    std::optional<T> dequeue() {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if (readableSlots(currentHead, 1) == 0) {
+            return std::nullopt;
+        }
+        std::optional<T> frontElement(std::move(slots[currentHead & mask]));
+        head.store(currentHead + 1, std::memory_order_release);
+        return frontElement;
+    }
+
+    /// Check if the queue is empty. Exact only when called from the consumer thread.
+    bool isEmpty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    /// Get the number of elements in the queue. A snapshot that may already be stale.
+    int count() const {
+        size_t currentHead = head.load(std::memory_order_acquire);
+        return static_cast<int>(tail.load(std::memory_order_acquire) - currentHead);
+    }
+
+    /// Maximum number of elements the queue can hold.
+    size_t capacity() const {
+        return slots.size();
+    }
+
+    // MARK: - Queue Operations with Array
+
+    /// Enqueue up to `count` elements from `source`, publishing them to the consumer
+    /// with a single release store. Returns how many elements were enqueued.
+    size_t enqueueArray(const T* source, size_t count) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        count = std::min(count, freeSlots(currentTail, count));
+        for (size_t i = 0; i < count; ++i) {
+            slots[(currentTail + i) & mask] = source[i];
+        }
+        if (count > 0) {
+            tail.store(currentTail + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    /// Enqueue as many elements of `array` as fit. Returns how many were enqueued.
+    size_t enqueueArray(const std::vector<T>& array) {
+        return enqueueArray(array.data(), array.size());
+    }
+
+    /// Dequeue up to `maxCount` elements into `destination`, releasing their slots to
+    /// the producer with a single store. Returns how many elements were dequeued.
+    size_t dequeueArray(T* destination, size_t maxCount) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        size_t count = std::min(maxCount, readableSlots(currentHead, maxCount));
+        for (size_t i = 0; i < count; ++i) {
+            destination[i] = std::move(slots[(currentHead + i) & mask]);
+        }
+        if (count > 0) {
+            head.store(currentHead + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    /// Dequeue up to `maxCount` elements from the front of the queue.
+    std::vector<T> dequeueArray(int maxCount) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        size_t count = std::min<size_t>(std::max(maxCount, 0), readableSlots(currentHead, std::max(maxCount, 0)));
+        std::vector<T> dequeuedElements;
+        dequeuedElements.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            dequeuedElements.push_back(std::move(slots[(currentHead + i) & mask]));
+        }
+        if (count > 0) {
+            head.store(currentHead + count, std::memory_order_release);
+        }
+        return dequeuedElements;
+    }
+};
+
+// MARK: - Multi-Producer/Multi-Consumer Queue
+
+/// A bounded queue shared by any number of producer and consumer threads.
+///
+/// Every cell carries a sequence number (Dmitry Vyukov's scheme): a cell at position
+/// `p` is free for a producer when its sequence equals `p` and holds an element for a
+/// consumer when its sequence equals `p + 1`. Threads claim positions with a CAS on
+/// the shared enqueue/dequeue counters and never take a lock on the fast path. The
+/// blocking operations spin briefly, then sleep on a condition variable (a futex on
+/// Linux) until the other side makes progress.
+template <typename T>
+class MpmcQueue {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+
+    alignas(cacheLineSize) std::atomic<size_t> enqueuePosition{0};
+    alignas(cacheLineSize) std::atomic<size_t> dequeuePosition{0};
+
+    // Slow path for the blocking operations.
+    alignas(cacheLineSize) std::atomic<int> waitingProducers{0};
+    std::atomic<int> waitingConsumers{0};
+    std::mutex waitMutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+
+    static constexpr int spinsBeforeSleeping = 64;
+
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    /// Claim up to `maxCount` consecutive cells whose sequence is `position + offset`
+    /// (free cells for producers, full cells for consumers). Returns the first claimed
+    /// position and stores how many were claimed in `claimed` (zero if none were ready).
+    size_t claimCells(std::atomic<size_t>& counter, size_t offset, size_t maxCount, size_t& claimed) {
+        size_t position = counter.load(std::memory_order_relaxed);
+        for (;;) {
+            size_t ready = 0;
+            while (ready < maxCount) {
+                size_t sequence = cells[(position + ready) & mask].sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<std::ptrdiff_t>(sequence - (position + ready + offset));
+                if (difference != 0) {
+                    if (ready == 0 && difference > 0) {
+                        // Another thread claimed this position already; catch up and retry.
+                        position = counter.load(std::memory_order_relaxed);
+                        continue;
+                    }
+                    break;
+                }
+                ++ready;
+            }
+            if (ready == 0) {
+                claimed = 0;
+                return position;
+            }
+            if (counter.compare_exchange_weak(position, position + ready, std::memory_order_relaxed)) {
+                claimed = ready;
+                return position;
+            }
+        }
+    }
+
+    size_t pushCells(const T* source, size_t count) {
+        size_t claimed = 0;
+        size_t position = claimCells(enqueuePosition, 0, count, claimed);
+        for (size_t i = 0; i < claimed; ++i) {
+            Cell& cell = cells[(position + i) & mask];
+            cell.value = source[i];
+            cell.sequence.store(position + i + 1, std::memory_order_release);
+        }
+        return claimed;
+    }
+
+    size_t popCells(T* destination, size_t maxCount) {
+        size_t claimed = 0;
+        size_t position = claimCells(dequeuePosition, 1, maxCount, claimed);
+        for (size_t i = 0; i < claimed; ++i) {
+            Cell& cell = cells[(position + i) & mask];
+            destination[i] = std::move(cell.value);
+            cell.sequence.store(position + i + mask + 1, std::memory_order_release);
+        }
+        return claimed;
+    }
+
+    /// Wake threads sleeping on `condition` if there are any. The fence pairs with the
+    /// one in `waitUntil` so a sleeper either sees our cell update or we see its count.
+    void wake(std::atomic<int>& waiters, std::condition_variable& condition) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(waitMutex);
+            condition.notify_all();
+        }
+    }
+
+    template <typename Attempt>
+    void waitUntil(std::atomic<int>& waiters, std::condition_variable& condition, Attempt attempt) {
+        for (int spin = 0; spin < spinsBeforeSleeping; ++spin) {
+            if (attempt()) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+        std::unique_lock<std::mutex> lock(waitMutex);
+        waiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        condition.wait(lock, attempt);
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+public:
+    /// Create a queue holding at most `capacity` elements (rounded up to a power of two).
+    explicit MpmcQueue(size_t capacity)
+        : cells(new Cell[roundUpToPowerOfTwo(std::max<size_t>(capacity, 2))]),
+          mask(roundUpToPowerOfTwo(std::max<size_t>(capacity, 2)) - 1) {
+        for (size_t i = 0; i <= mask; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue<T>&) = delete;
+    MpmcQueue<T>& operator=(const MpmcQueue<T>&) = delete;
+
+    // MARK: - Non-Blocking Operations
+
+    /// Enqueue an element to the back of the queue. Returns false if the queue is full.
+    bool tryEnqueue(const T& element) {
+        if (pushCells(&element, 1) == 0) {
+            return false;
+        }
+        wake(waitingConsumers, notEmpty);
+        return true;
+    }
+
+    /// Dequeue an element from the front of the queue, or nothing if the queue is empty.
+    std::optional<T> tryDequeue() {
+        T frontElement;
+        if (popCells(&frontElement, 1) == 0) {
+            return std::nullopt;
+        }
+        wake(waitingProducers, notFull);
+        return frontElement;
+    }
+
+    // MARK: - Blocking Operations
+
+    /// Enqueue an element, waiting for a free slot if the queue is full.
+    void enqueue(const T& element) {
+        waitUntil(waitingProducers, notFull, [this, &element] { return pushCells(&element, 1) == 1; });
+        wake(waitingConsumers, notEmpty);
+    }
+
+    /// Dequeue the front element, waiting for one to arrive if the queue is empty.
+    T dequeue() {
+        T frontElement;
+        waitUntil(waitingConsumers, notEmpty, [this, &frontElement] { return popCells(&frontElement, 1) == 1; });
+        wake(waitingProducers, notFull);
+        return frontElement;
+    }
+
+    // MARK: - Queue Operations with Array
+
+    /// Enqueue up to `count` elements from `source` with a single claim on the queue.
+    /// Returns how many elements were enqueued (zero if the queue is full).
+    size_t enqueueArray(const T* source, size_t count) {
+        size_t enqueued = pushCells(source, count);
+        if (enqueued > 0) {
+            wake(waitingConsumers, notEmpty);
+        }
+        return enqueued;
+    }
+
+    /// Enqueue as many elements of `array` as fit in one claim. Returns how many were enqueued.
+    size_t enqueueArray(const std::vector<T>& array) {
+        return enqueueArray(array.data(), array.size());
+    }
+
+    /// Drain up to `maxCount` elements into `destination` with a single claim on the
+    /// queue. Returns how many elements were dequeued (zero if the queue is empty).
+    size_t dequeueArray(T* destination, size_t maxCount) {
+        size_t dequeued = popCells(destination, maxCount);
+        if (dequeued > 0) {
+            wake(waitingProducers, notFull);
+        }
+        return dequeued;
+    }
+
+    /// Drain up to `maxCount` elements from the front of the queue.
+    std::vector<T> dequeueArray(int maxCount) {
+        std::vector<T> dequeuedElements(std::max(maxCount, 0));
+        dequeuedElements.resize(dequeueArray(dequeuedElements.data(), dequeuedElements.size()));
+        return dequeuedElements;
+    }
+
+    /// Check if the queue is empty. A snapshot that may already be stale.
+    bool isEmpty() const {
+        return count() == 0;
+    }
+
+    /// Get the number of elements in the queue. A snapshot that may already be stale.
+    int count() const {
+        size_t dequeued = dequeuePosition.load(std::memory_order_acquire);
+        size_t enqueued = enqueuePosition.load(std::memory_order_acquire);
+        return enqueued > dequeued ? static_cast<int>(enqueued - dequeued) : 0;
+    }
+
+    /// Maximum number of elements the queue can hold.
+    size_t capacity() const {
+        return mask + 1;
+    }
+};
+
+// MARK: - Benchmark
+
+/// The previous vector-backed queue, kept as the baseline for the benchmark:
+/// every dequeue erases the front of the vector and shifts the remainder.
+template <typename T>
+class VectorQueue {
+private:
+    std::vector<T> elements;
+
+public:
+    void enqueue(T element) {
+        elements.push_back(element);
+    }
+
+    T dequeue() {
+        T frontElement = elements.front();
+        elements.erase(elements.begin());
+        return frontElement;
+    }
+
+    std::vector<T> dequeueArray(int count) {
+        std::vector<T> dequeuedElements;
+        for (int i = 0; i < count; ++i) {
+            dequeuedElements.push_back(elements.front());
+            elements.erase(elements.begin());
+        }
+        return dequeuedElements;
+    }
+};
+
+/// Written by benchmarks so the optimizer cannot drop the measured loops.
+volatile long long benchmarkSink = 0;
+
+template <typename Queue>
+double nanosecondsPerItem(int itemCount, int batchSize) {
+    Queue queue;
+    long long checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < itemCount; ++i) {
+        queue.enqueue(i);
+    }
+    if (batchSize == 1) {
+        for (int i = 0; i < itemCount; ++i) {
+            checksum += queue.dequeue();
+        }
+    } else {
+        for (int drained = 0; drained < itemCount; drained += batchSize) {
+            std::vector<int> batch = queue.dequeueArray(std::min(batchSize, itemCount - drained));
+            checksum += batch.back();
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    benchmarkSink = checksum;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / itemCount;
+}
+
+void benchmarkQueues() {
+    std::cout << "Fill then drain, ns per item (vector baseline vs ring buffer)" << std::endl;
+    for (int batchSize : {1, 64}) {
+        for (int itemCount : {1000, 10000, 100000, 1000000}) {
+            std::cout << "  items=" << itemCount << " batch=" << batchSize << ": ";
+            if (itemCount <= 100000) {
+                std::cout << "vector " << nanosecondsPerItem<VectorQueue<int>>(itemCount, batchSize) << ", ";
+            } else {
+                std::cout << "vector (skipped, quadratic), ";
+            }
+            std::cout << "ring " << nanosecondsPerItem<CustomQueue<int>>(itemCount, batchSize) << std::endl;
+        }
+    }
+}
+
+/// The setup SpscQueue replaces: a CustomQueue shared by two threads behind a mutex.
+template <typename T>
+class MutexQueue {
+private:
+    std::mutex mutex;
+    CustomQueue<T> queue;
+
+public:
+    size_t enqueueArray(const T* source, size_t count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < count; ++i) {
+            queue.enqueue(source[i]);
+        }
+        return count;
+    }
+
+    size_t dequeueArray(T* destination, size_t maxCount) {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t count = std::min<size_t>(maxCount, queue.count());
+        for (size_t i = 0; i < count; ++i) {
+            destination[i] = queue.dequeue();
+        }
+        return count;
+    }
+};
+
+/// Stream `itemCount` items from a producer thread to the calling thread in batches
+/// and return the throughput in millions of items per second.
+template <typename Queue>
+double itemsPerMicrosecond(Queue& queue, size_t itemCount, size_t batchSize) {
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&queue, itemCount, batchSize] {
+        std::vector<long long> batch(batchSize);
+        for (size_t sent = 0; sent < itemCount;) {
+            size_t count = std::min(batchSize, itemCount - sent);
+            for (size_t i = 0; i < count; ++i) {
+                batch[i] = static_cast<long long>(sent + i);
+            }
+            size_t pushed = 0;
+            while (pushed < count) {
+                size_t accepted = queue.enqueueArray(batch.data() + pushed, count - pushed);
+                if (accepted == 0) {
+                    std::this_thread::yield();
+                }
+                pushed += accepted;
+            }
+            sent += count;
+        }
+    });
+    std::vector<long long> batch(batchSize);
+    long long checksum = 0;
+    for (size_t received = 0; received < itemCount;) {
+        size_t count = queue.dequeueArray(batch.data(), batchSize);
+        if (count == 0) {
+            std::this_thread::yield();
+        }
+        for (size_t i = 0; i < count; ++i) {
+            checksum += batch[i];
+        }
+        received += count;
+    }
+    producer.join();
+    benchmarkSink = checksum;
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return itemCount / std::chrono::duration<double, std::micro>(elapsed).count();
+}
+
+/// Bounce a batch between two threads through a pair of queues and return the mean
+/// one-way latency of a batch in nanoseconds.
+double oneWayLatencyNanoseconds(size_t batchSize, int roundTrips) {
+    SpscQueue<long long> requests(1024);
+    SpscQueue<long long> replies(1024);
+    std::thread echo([&requests, &replies, batchSize, roundTrips] {
+        std::vector<long long> batch(batchSize);
+        for (int round = 0; round < roundTrips; ++round) {
+            for (size_t received = 0; received < batchSize;) {
+                size_t count = requests.dequeueArray(batch.data() + received, batchSize - received);
+                if (count == 0) {
+                    std::this_thread::yield();
+                }
+                received += count;
+            }
+            while (replies.enqueueArray(batch.data(), batchSize) == 0) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::vector<long long> batch(batchSize, 1);
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < roundTrips; ++round) {
+        requests.enqueueArray(batch.data(), batchSize);
+        for (size_t received = 0; received < batchSize;) {
+            size_t count = replies.dequeueArray(batch.data() + received, batchSize - received);
+            if (count == 0) {
+                std::this_thread::yield();
+            }
+            received += count;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    echo.join();
+    return std::chrono::duration<double, std::nano>(elapsed).count() / (2.0 * roundTrips);
+}
+
+void benchmarkSpscQueue() {
+    const size_t itemCount = 4000000;
+    std::cout << "SPSC throughput, million items/s (mutex-wrapped CustomQueue vs SpscQueue)" << std::endl;
+    for (size_t batchSize : {1, 8, 64}) {
+        MutexQueue<long long> mutexQueue;
+        SpscQueue<long long> spscQueue(4096);
+        std::cout << "  batch=" << batchSize
+                  << ": mutex " << itemsPerMicrosecond(mutexQueue, itemCount, batchSize)
+                  << ", spsc " << itemsPerMicrosecond(spscQueue, itemCount, batchSize) << std::endl;
+    }
+    std::cout << "SPSC one-way batch latency, ns" << std::endl;
+    for (size_t batchSize : {1, 8, 64}) {
+        std::cout << "  batch=" << batchSize << ": " << oneWayLatencyNanoseconds(batchSize, 20000) << std::endl;
+    }
+}
+
+/// Run `threadCount` producers and `threadCount` consumers that move `itemCount` items
+/// through `queue` in batches, and return the throughput in millions of items per second.
+template <typename Queue>
+double contendedItemsPerMicrosecond(Queue& queue, size_t threadCount, size_t itemCount, size_t batchSize) {
+    std::atomic<size_t> produced{0};
+    std::atomic<size_t> consumed{0};
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&queue, &produced, itemCount, batchSize] {
+            std::vector<long long> batch(batchSize, 1);
+            for (;;) {
+                size_t first = produced.fetch_add(batchSize, std::memory_order_relaxed);
+                if (first >= itemCount) {
+                    return;
+                }
+                size_t count = std::min(batchSize, itemCount - first);
+                for (size_t pushed = 0; pushed < count;) {
+                    size_t accepted = queue.enqueueArray(batch.data() + pushed, count - pushed);
+                    if (accepted == 0) {
+                        std::this_thread::yield();
+                    }
+                    pushed += accepted;
+                }
+            }
+        });
+        threads.emplace_back([&queue, &consumed, itemCount, batchSize] {
+            std::vector<long long> batch(batchSize);
+            while (consumed.load(std::memory_order_relaxed) < itemCount) {
+                size_t count = queue.dequeueArray(batch.data(), batchSize);
+                if (count == 0) {
+                    std::this_thread::yield();
+                }
+                consumed.fetch_add(count, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return itemCount / std::chrono::duration<double, std::micro>(elapsed).count();
+}
+
+void benchmarkMpmcQueue() {
+    const size_t itemCount = 2000000;
+    size_t coreCount = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < coreCount; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(coreCount);
+
+    std::cout << "MPMC throughput, million items/s (mutex-wrapped CustomQueue vs MpmcQueue)" << std::endl;
+    for (size_t batchSize : {1, 16}) {
+        for (size_t threads : threadCounts) {
+            MutexQueue<long long> mutexQueue;
+            MpmcQueue<long long> mpmcQueue(4096);
+            std::cout << "  producers=consumers=" << threads << " batch=" << batchSize
+                      << ": mutex " << contendedItemsPerMicrosecond(mutexQueue, threads, itemCount, batchSize)
+                      << ", mpmc " << contendedItemsPerMicrosecond(mpmcQueue, threads, itemCount, batchSize)
+                      << std::endl;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
     CustomQueue<int> queue;
     queue.enqueue(1);
     queue.enqueue(2);
@@ -157,5 +986,11 @@ int main() {
         std::cout << queue.dequeue() << std::endl;
     }
 
+    if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+        benchmarkQueues();
+        benchmarkSpscQueue();
+        benchmarkMpmcQueue();
+    }
+
     return 0;
 }
@@ -1,10 +1,191 @@
 #include <unordered_map>
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-template <typename T>
+// Fork-join pool for the parallel set operations. A pool of n threads keeps n - 1 workers
+// parked between jobs; the calling thread takes part in every job as the n-th.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable jobPosted;
+    std::condition_variable jobFinished;
+    std::function<void(size_t)> job;
+    size_t taskCount = 0;
+    std::atomic<size_t> nextTask{0};
+    size_t activeWorkers = 0;
+    size_t generation = 0;
+    bool stopping = false;
+    std::exception_ptr failure;
+
+    void runTasks() {
+        for (size_t task; (task = nextTask.fetch_add(1, std::memory_order_relaxed)) < taskCount;) {
+            try {
+                job(task);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!failure) {
+                    failure = std::current_exception();
+                }
+            }
+        }
+    }
+
+    void workerLoop() {
+        size_t seenGeneration = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobPosted.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) {
+                    return;
+                }
+                seenGeneration = generation;
+            }
+            runTasks();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--activeWorkers == 0) {
+                jobFinished.notify_one();
+            }
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t threadCount = std::max(1u, std::thread::hardware_concurrency())) {
+        for (size_t i = 1; i < threadCount; ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        jobPosted.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    size_t threadCount() const {
+        return workers.size() + 1;
+    }
+
+    /// Calls `task(i)` for every i in [0, count) across the pool and returns once all calls
+    /// have finished, rethrowing the first exception a task threw.
+    void forEachIndex(size_t count, std::function<void(size_t)> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = std::move(task);
+            taskCount = count;
+            nextTask.store(0, std::memory_order_relaxed);
+            activeWorkers = workers.size();
+            failure = nullptr;
+            ++generation;
+        }
+        jobPosted.notify_all();
+        runTasks();
+        std::unique_lock<std::mutex> lock(mutex);
+        jobFinished.wait(lock, [&] { return activeWorkers == 0; });
+        job = nullptr;
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+    }
+};
+
+template <typename T, typename Allocator = std::allocator<std::pair<const T, bool>>>
 class CustomSet {
 private:
-    std::unordered_map<T, bool> elements;  // Hash table to mimic a set
+    using Table = std::unordered_map<T, bool, std::hash<T>, std::equal_to<T>, Allocator>;
+
+    Table elements;  // Hash table to mimic a set
+
+    // Splits the buckets into contiguous ranges, a few per pool thread so that uneven
+    // ranges balance out, and calls visit(range, element) for every element in parallel.
+    // Each range is visited by one thread at a time, so per-range state needs no lock.
+    // Returns the number of ranges.
+    template <typename Visit>
+    size_t forEachInParallel(ThreadPool& pool, Visit visit) const {
+        size_t bucketCount = elements.bucket_count();
+        size_t rangeCount = std::min(bucketCount, pool.threadCount() * 4);
+        pool.forEachIndex(rangeCount, [&](size_t range) {
+            size_t end = bucketCount * (range + 1) / rangeCount;
+            for (size_t bucket = bucketCount * range / rangeCount; bucket < end; ++bucket) {
+                for (auto it = elements.begin(bucket); it != elements.end(bucket); ++it) {
+                    if (!visit(range, it->first)) {
+                        return;
+                    }
+                }
+            }
+        });
+        return rangeCount;
+    }
+
+    // Inserts the elements of `source` for which `keep` holds into `target`. Every range
+    // builds its own table in parallel, allocating and constructing the nodes; those are
+    // then spliced into `target` with merge(), which relinks nodes without copying them.
+    // The splice is serial, since an unordered_map cannot be linked into from two threads.
+    // Callers pass sources whose kept elements are not in `target` yet.
+    template <typename Keep>
+    static void insertMatching(CustomSet& target, const CustomSet& source, ThreadPool& pool, Keep keep) {
+        std::vector<Table> kept(pool.threadCount() * 4);
+        size_t rangeCount = source.forEachInParallel(pool, [&](size_t range, const T& element) {
+            if (keep(element)) {
+                kept[range].emplace(element, true);
+            }
+            return true;
+        });
+        size_t total = target.elements.size();
+        for (size_t range = 0; range < rangeCount; ++range) {
+            total += kept[range].size();
+        }
+        target.elements.reserve(total);
+        for (size_t range = 0; range < rangeCount; ++range) {
+            target.elements.merge(kept[range]);
+        }
+    }
+
+    // True if `predicate` holds for some element of `source`; every thread stops as soon
+    // as any thread finds one.
+    template <typename Predicate>
+    static bool anyInParallel(const CustomSet& source, ThreadPool& pool, Predicate predicate) {
+        std::atomic<bool> found{false};
+        source.forEachInParallel(pool, [&](size_t, const T& element) {
+            if (found.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            if (predicate(element)) {
+                found.store(true, std::memory_order_relaxed);
+                return false;
+            }
+            return true;
+        });
+        return found.load();
+    }
 
 public:
     // Basic Set Operations
@@ -31,16 +212,16 @@ public:
 
     // Set Operations
 
-    CustomSet<T> unionWith(const CustomSet<T>& otherSet) const {
-        CustomSet<T> newSet(*this);
+    CustomSet unionWith(const CustomSet& otherSet) const {
+        CustomSet newSet(*this);
         for (const auto& entry : otherSet.elements) {
             newSet.insert(entry.first);
         }
         return newSet;
     }
 
-    CustomSet<T> intersectionWith(const CustomSet<T>& otherSet) const {
-        CustomSet<T> newSet;
+    CustomSet intersectionWith(const CustomSet& otherSet) const {
+        CustomSet newSet;
         for (const auto& entry : elements) {
             if (otherSet.contains(entry.first)) {
                 newSet.insert(entry.first);
@@ -49,15 +230,15 @@ public:
         return newSet;
     }
 
-    CustomSet<T> differenceWith(const CustomSet<T>& otherSet) const {
-        CustomSet<T> newSet(*this);
+    CustomSet differenceWith(const CustomSet& otherSet) const {
+        CustomSet newSet(*this);
         for (const auto& entry : otherSet.elements) {
             newSet.remove(entry.first);
         }
         return newSet;
     }
 
-    bool isSubsetOf(const CustomSet<T>& otherSet) const {
+    bool isSubsetOf(const CustomSet& otherSet) const {
         for (const auto& entry : elements) {
             if (!otherSet.contains(entry.first)) {
                 return false;
@@ -66,11 +247,50 @@ public:
         return true;
     }
 
-    bool isSupersetOf(const CustomSet<T>& otherSet) const {
+    bool isSupersetOf(const CustomSet& otherSet) const {
         return otherSet.isSubsetOf(*this);
     }
 
-    bool isDisjointWith(const CustomSet<T>& otherSet) const {
+    // Parallel Set Operations
+
+    // These take a ThreadPool and split the scan of the operand they iterate over its
+    // buckets. Lookups and building the result's nodes run in parallel; only splicing the
+    // per-range tables into the result is one thread's work.
+
+    CustomSet unionWith(const CustomSet& otherSet, ThreadPool& pool) const {
+        CustomSet newSet;
+        newSet.elements.reserve(count() + otherSet.count());
+        insertMatching(newSet, *this, pool, [](const T&) { return true; });
+        insertMatching(newSet, otherSet, pool, [this](const T& element) { return !contains(element); });
+        return newSet;
+    }
+
+    CustomSet intersectionWith(const CustomSet& otherSet, ThreadPool& pool) const {
+        const CustomSet& smaller = count() <= otherSet.count() ? *this : otherSet;
+        const CustomSet& larger = &smaller == this ? otherSet : *this;
+        CustomSet newSet;
+        insertMatching(newSet, smaller, pool, [&larger](const T& element) { return larger.contains(element); });
+        return newSet;
+    }
+
+    CustomSet differenceWith(const CustomSet& otherSet, ThreadPool& pool) const {
+        CustomSet newSet;
+        insertMatching(newSet, *this, pool, [&otherSet](const T& element) { return !otherSet.contains(element); });
+        return newSet;
+    }
+
+    bool isSubsetOf(const CustomSet& otherSet, ThreadPool& pool) const {
+        return count() <= otherSet.count() &&
+               !anyInParallel(*this, pool, [&otherSet](const T& element) { return !otherSet.contains(element); });
+    }
+
+    bool isDisjointWith(const CustomSet& otherSet, ThreadPool& pool) const {
+        const CustomSet& smaller = count() <= otherSet.count() ? *this : otherSet;
+        const CustomSet& larger = &smaller == this ? otherSet : *this;
+        return !anyInParallel(smaller, pool, [&larger](const T& element) { return larger.contains(element); });
+    }
+
+    bool isDisjointWith(const CustomSet& otherSet) const {
         for (const auto& entry : elements) {
             if (otherSet.contains(entry.first)) {
                 return false;
@@ -85,6 +305,59 @@ public:
         }
     }
 
+    // Iteration (read-only, in hash-table order), so a set can feed range-for loops and
+    // anything that takes an iterator range.
+
+    class const_iterator {
+    private:
+        typename Table::const_iterator position;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() = default;
+        explicit const_iterator(typename Table::const_iterator position) : position(position) {}
+
+        reference operator*() const {
+            return position->first;
+        }
+
+        pointer operator->() const {
+            return &position->first;
+        }
+
+        const_iterator& operator++() {
+            ++position;
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            ++position;
+            return previous;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return position == other.position;
+        }
+
+        bool operator!=(const const_iterator& other) const {
+            return position != other.position;
+        }
+    };
+
+    const_iterator begin() const {
+        return const_iterator(elements.begin());
+    }
+
+    const_iterator end() const {
+        return const_iterator(elements.end());
+    }
+
     void removeAll() {
         elements.clear();
     }
@@ -93,29 +366,1238 @@ public:
         elements.erase(element);
     }
 
-    CustomSet<T> symmetricDifferenceWith(const CustomSet<T>& otherSet) const {
-        CustomSet<T> diff1 = this->differenceWith(otherSet);
-        CustomSet<T> diff2 = otherSet.differenceWith(*this);
-        return diff1.unionWith(diff2);
+    CustomSet symmetricDifferenceWith(const CustomSet& otherSet) const {
+        CustomSet newSet;
+        newSet.elements.reserve(elements.size() + otherSet.elements.size());
+        for (const auto& entry : elements) {
+            if (!otherSet.contains(entry.first)) {
+                newSet.elements.emplace(entry.first, true);
+            }
+        }
+        for (const auto& entry : otherSet.elements) {
+            if (!contains(entry.first)) {
+                newSet.elements.emplace(entry.first, true);
+            }
+        }
+        return newSet;
     }
 
-    void formUnionWith(const CustomSet<T>& otherSet) {
-        *this = this->unionWith(otherSet);
+    // The form* methods and subtract mutate in place: no copy of either operand, and the
+    // table is grown at most once, up front.
+
+    void formUnionWith(const CustomSet& otherSet) {
+        if (this == &otherSet) {
+            return;
+        }
+        elements.reserve(elements.size() + otherSet.elements.size());
+        for (const auto& entry : otherSet.elements) {
+            elements.emplace(entry.first, true);
+        }
     }
 
-    void formIntersectionWith(const CustomSet<T>& otherSet) {
-        *this = this->intersectionWith(otherSet);
+    void formIntersectionWith(const CustomSet& otherSet) {
+        for (auto it = elements.begin(); it != elements.end();) {
+            it = otherSet.contains(it->first) ? std::next(it) : elements.erase(it);
+        }
     }
 
-    void subtract(const CustomSet<T>& otherSet) {
-        *this = this->differenceWith(otherSet);
+    void subtract(const CustomSet& otherSet) {
+        if (this == &otherSet) {
+            elements.clear();
+        } else if (otherSet.elements.size() < elements.size()) {
+            for (const auto& entry : otherSet.elements) {
+                elements.erase(entry.first);
+            }
+        } else {
+            for (auto it = elements.begin(); it != elements.end();) {
+                it = otherSet.contains(it->first) ? elements.erase(it) : std::next(it);
+            }
+        }
+    }
+
+    void formSymmetricDifferenceWith(const CustomSet& otherSet) {
+        if (this == &otherSet) {
+            elements.clear();
+            return;
+        }
+        elements.reserve(elements.size() + otherSet.elements.size());
+        for (const auto& entry : otherSet.elements) {
+            if (elements.erase(entry.first) == 0) {
+                elements.emplace(entry.first, true);
+            }
+        }
     }
 
     // ... Add more set operations as needed ...
 };
 
+// Intersection of two sorted, duplicate-free arrays of 32-bit integers. With SSE2 it
+// compares a block of four elements from each side in all four rotations at once, emits
+// the matches, and advances whichever block ends lower (both when they end equal).
+template <typename T>
+size_t intersectSorted32(const T* a, size_t aCount, const T* b, size_t bCount, T* out) {
+    static_assert(sizeof(T) == 4 && std::is_integral<T>::value, "32-bit integers only");
+    size_t i = 0;
+    size_t j = 0;
+    size_t count = 0;
+#if defined(__SSE2__)
+    while (i + 4 <= aCount && j + 4 <= bCount) {
+        __m128i blockA = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i blockB = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+        __m128i equal = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(blockA, blockB),
+                         _mm_cmpeq_epi32(blockA, _mm_shuffle_epi32(blockB, _MM_SHUFFLE(0, 3, 2, 1)))),
+            _mm_or_si128(_mm_cmpeq_epi32(blockA, _mm_shuffle_epi32(blockB, _MM_SHUFFLE(1, 0, 3, 2))),
+                         _mm_cmpeq_epi32(blockA, _mm_shuffle_epi32(blockB, _MM_SHUFFLE(2, 1, 0, 3)))));
+        for (int mask = _mm_movemask_ps(_mm_castsi128_ps(equal)); mask != 0; mask &= mask - 1) {
+            out[count++] = a[i + __builtin_ctz(mask)];
+        }
+        T lastA = a[i + 3];
+        T lastB = b[j + 3];
+        i += lastA <= lastB ? 4 : 0;
+        j += lastB <= lastA ? 4 : 0;
+    }
+#endif
+    while (i < aCount && j < bCount) {
+        if (a[i] < b[j]) {
+            ++i;
+        } else if (b[j] < a[i]) {
+            ++j;
+        } else {
+            out[count++] = a[i];
+            ++i;
+            ++j;
+        }
+    }
+    return count;
+}
+
+// A set kept as a sorted vector without duplicates. contains is a binary search over
+// contiguous memory, and union, intersection, difference and symmetric difference are
+// each one linear merge of the two operands, with no per-element allocation. insert and
+// remove shift the tail, so this suits sets that are built in bulk and then mostly read.
+template <typename T, typename Allocator = std::allocator<T>>
+class SortedFlatSet {
+private:
+    using Values = std::vector<T, Allocator>;
+
+    Values elements;
+
+    // When one side is this many times smaller, binary-searching its elements in the
+    // other beats walking both.
+    static constexpr size_t gallopRatio = 32;
+
+    static SortedFlatSet fromSorted(Values&& sorted) {
+        SortedFlatSet set;
+        set.elements = std::move(sorted);
+        return set;
+    }
+
+public:
+    SortedFlatSet() = default;
+
+    explicit SortedFlatSet(Values values) : elements(std::move(values)) {
+        std::sort(elements.begin(), elements.end());
+        elements.erase(std::unique(elements.begin(), elements.end()), elements.end());
+    }
+
+    // Basic Set Operations
+
+    bool isEmpty() const {
+        return elements.empty();
+    }
+
+    int count() const {
+        return elements.size();
+    }
+
+    void insert(const T& element) {
+        auto position = std::lower_bound(elements.begin(), elements.end(), element);
+        if (position == elements.end() || element < *position) {
+            elements.insert(position, element);
+        }
+    }
+
+    /// Insert many elements with one sort and merge instead of one shift per element.
+    void insertArray(const std::vector<T>& values) {
+        size_t oldCount = elements.size();
+        elements.insert(elements.end(), values.begin(), values.end());
+        std::sort(elements.begin() + oldCount, elements.end());
+        std::inplace_merge(elements.begin(), elements.begin() + oldCount, elements.end());
+        elements.erase(std::unique(elements.begin(), elements.end()), elements.end());
+    }
+
+    bool remove(const T& element) {
+        auto position = std::lower_bound(elements.begin(), elements.end(), element);
+        if (position == elements.end() || element < *position) {
+            return false;
+        }
+        elements.erase(position);
+        return true;
+    }
+
+    bool contains(const T& element) const {
+        return std::binary_search(elements.begin(), elements.end(), element);
+    }
+
+    void reserve(size_t capacity) {
+        elements.reserve(capacity);
+    }
+
+    // Set Operations
+
+    SortedFlatSet unionWith(const SortedFlatSet& otherSet) const {
+        Values result;
+        result.reserve(elements.size() + otherSet.elements.size());
+        std::set_union(elements.begin(), elements.end(), otherSet.elements.begin(), otherSet.elements.end(),
+                       std::back_inserter(result));
+        return fromSorted(std::move(result));
+    }
+
+    SortedFlatSet intersectionWith(const SortedFlatSet& otherSet) const {
+        const Values& smaller = count() <= otherSet.count() ? elements : otherSet.elements;
+        const Values& larger = count() <= otherSet.count() ? otherSet.elements : elements;
+        Values result;
+        if (smaller.size() * gallopRatio < larger.size()) {
+            auto searchFrom = larger.begin();
+            for (const T& element : smaller) {
+                searchFrom = std::lower_bound(searchFrom, larger.end(), element);
+                if (searchFrom == larger.end()) {
+                    break;
+                }
+                if (!(element < *searchFrom)) {
+                    result.push_back(element);
+                }
+            }
+        } else if constexpr (sizeof(T) == 4 && std::is_integral<T>::value) {
+            result.resize(smaller.size());
+            result.resize(intersectSorted32(smaller.data(), smaller.size(), larger.data(), larger.size(),
+                                            result.data()));
+        } else {
+            result.reserve(smaller.size());
+            std::set_intersection(smaller.begin(), smaller.end(), larger.begin(), larger.end(),
+                                  std::back_inserter(result));
+        }
+        return fromSorted(std::move(result));
+    }
+
+    SortedFlatSet differenceWith(const SortedFlatSet& otherSet) const {
+        Values result;
+        result.reserve(elements.size());
+        std::set_difference(elements.begin(), elements.end(), otherSet.elements.begin(), otherSet.elements.end(),
+                            std::back_inserter(result));
+        return fromSorted(std::move(result));
+    }
+
+    SortedFlatSet symmetricDifferenceWith(const SortedFlatSet& otherSet) const {
+        Values result;
+        result.reserve(elements.size() + otherSet.elements.size());
+        std::set_symmetric_difference(elements.begin(), elements.end(), otherSet.elements.begin(),
+                                      otherSet.elements.end(), std::back_inserter(result));
+        return fromSorted(std::move(result));
+    }
+
+    bool isSubsetOf(const SortedFlatSet& otherSet) const {
+        return std::includes(otherSet.elements.begin(), otherSet.elements.end(), elements.begin(), elements.end());
+    }
+
+    bool isSupersetOf(const SortedFlatSet& otherSet) const {
+        return otherSet.isSubsetOf(*this);
+    }
+
+    bool isDisjointWith(const SortedFlatSet& otherSet) const {
+        auto left = elements.begin();
+        auto right = otherSet.elements.begin();
+        while (left != elements.end() && right != otherSet.elements.end()) {
+            if (*left < *right) {
+                ++left;
+            } else if (*right < *left) {
+                ++right;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void forEach(void (*closure)(const T&)) const {
+        for (const T& element : elements) {
+            closure(element);
+        }
+    }
+
+    void removeAll() {
+        elements.clear();
+    }
+
+    void removeAllOccurrencesOf(const T& element) {
+        remove(element);
+    }
+
+    void formUnionWith(const SortedFlatSet& otherSet) {
+        *this = unionWith(otherSet);
+    }
+
+    void formIntersectionWith(const SortedFlatSet& otherSet) {
+        *this = intersectionWith(otherSet);
+    }
+
+    void subtract(const SortedFlatSet& otherSet) {
+        *this = differenceWith(otherSet);
+    }
+
+    // Iteration (ascending order)
+
+    typename Values::const_iterator begin() const {
+        return elements.begin();
+    }
+
+    typename Values::const_iterator end() const {
+        return elements.end();
+    }
+};
+
+// A compressed bitmap for sets of integers up to 32 bits wide (Roaring). Values are
+// grouped by their high 16 bits into chunks of 65536; each non-empty chunk stores its
+// low 16 bits in whichever container is smallest:
+//   array   sorted uint16 values, for chunks of at most 4096 members (2 bytes each)
+//   bitmap  65536 bits in 1024 words, for denser chunks (8 KB flat)
+//   run     (start, length - 1) pairs, for long consecutive stretches (see runOptimize)
+// Set algebra walks both operands chunk by chunk. Sparse pairs merge sorted arrays;
+// otherwise the work is word-wise AND/OR/XOR/ANDNOT over bitmaps with popcount, which
+// compilers vectorize. serialize() writes the portable Roaring format shared by the
+// C, Java and Go implementations.
+template <typename T>
+class RoaringSet {
+    static_assert(std::is_integral<T>::value && sizeof(T) <= 4, "RoaringSet holds integers of up to 32 bits");
+
+private:
+    static constexpr uint32_t maxArraySize = 4096;
+    static constexpr size_t bitmapWords = 1024;
+    static constexpr uint32_t cookieWithoutRuns = 12346;
+    static constexpr uint32_t cookieWithRuns = 12347;
+    static constexpr uint32_t offsetThreshold = 4;  // run-format files carry offsets from this many containers
+
+    struct Run {
+        uint16_t start;
+        uint16_t length;  // members are start ... start + length
+    };
+
+    struct Container {
+        enum class Kind : uint8_t { array, bitmap, run };
+
+        Kind kind = Kind::array;
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> values;  // array: the sorted members
+        std::vector<uint64_t> words;   // bitmap: bit i of the chunk is member i
+        std::vector<Run> runs;         // run: sorted, non-overlapping runs
+    };
+
+    enum class Operation { union_, intersection, difference, symmetricDifference };
+
+    std::vector<uint16_t> keys;  // sorted high 16 bits, one per container
+    std::vector<Container> containers;
+
+    // Signed values are offset by 2^31 so that iteration runs in numeric order.
+    static uint32_t toBits(T value) {
+        if constexpr (std::is_signed<T>::value) {
+            return static_cast<uint32_t>(static_cast<int32_t>(value)) ^ 0x80000000u;
+        } else {
+            return static_cast<uint32_t>(value);
+        }
+    }
+
+    static T fromBits(uint32_t bits) {
+        if constexpr (std::is_signed<T>::value) {
+            return static_cast<T>(static_cast<int32_t>(bits ^ 0x80000000u));
+        } else {
+            return static_cast<T>(bits);
+        }
+    }
+
+    // Container Helpers
+
+    static bool containerContains(const Container& container, uint16_t low) {
+        switch (container.kind) {
+            case Container::Kind::array:
+                return std::binary_search(container.values.begin(), container.values.end(), low);
+            case Container::Kind::bitmap:
+                return (container.words[low >> 6] >> (low & 63)) & 1;
+            case Container::Kind::run: {
+                auto after = std::upper_bound(container.runs.begin(), container.runs.end(), low,
+                                              [](uint16_t value, const Run& run) { return value < run.start; });
+                return after != container.runs.begin() && low - (after - 1)->start <= (after - 1)->length;
+            }
+        }
+        return false;
+    }
+
+    // Few enough members to handle as a sorted array.
+    static bool isSparse(const Container& container) {
+        return container.cardinality <= maxArraySize && container.kind != Container::Kind::bitmap;
+    }
+
+    static std::vector<uint16_t> valuesOf(const Container& container) {
+        if (container.kind == Container::Kind::array) {
+            return container.values;
+        }
+        std::vector<uint16_t> values;
+        values.reserve(container.cardinality);
+        forEachIn(container, [&values](uint16_t low) { values.push_back(low); });
+        return values;
+    }
+
+    static std::vector<uint64_t> wordsOf(const Container& container) {
+        if (container.kind == Container::Kind::bitmap) {
+            return container.words;
+        }
+        std::vector<uint64_t> words(bitmapWords, 0);
+        if (container.kind == Container::Kind::array) {
+            for (uint16_t low : container.values) {
+                words[low >> 6] |= uint64_t(1) << (low & 63);
+            }
+        } else {
+            for (const Run& run : container.runs) {
+                for (uint32_t low = run.start; low <= uint32_t(run.start) + run.length; ++low) {
+                    words[low >> 6] |= uint64_t(1) << (low & 63);
+                }
+            }
+        }
+        return words;
+    }
+
+    template <typename Visit>
+    static void forEachIn(const Container& container, Visit visit) {
+        switch (container.kind) {
+            case Container::Kind::array:
+                for (uint16_t low : container.values) {
+                    visit(low);
+                }
+                break;
+            case Container::Kind::bitmap:
+                for (size_t word = 0; word < bitmapWords; ++word) {
+                    for (uint64_t bits = container.words[word]; bits != 0; bits &= bits - 1) {
+                        visit(static_cast<uint16_t>(word * 64 + __builtin_ctzll(bits)));
+                    }
+                }
+                break;
+            case Container::Kind::run:
+                for (const Run& run : container.runs) {
+                    for (uint32_t low = run.start; low <= uint32_t(run.start) + run.length; ++low) {
+                        visit(static_cast<uint16_t>(low));
+                    }
+                }
+                break;
+        }
+    }
+
+    static Container fromValues(std::vector<uint16_t> values) {
+        Container container;
+        container.cardinality = values.size();
+        container.values = std::move(values);
+        if (container.cardinality > maxArraySize) {
+            container.words = wordsOf(container);
+            container.values = std::vector<uint16_t>();
+            container.kind = Container::Kind::bitmap;
+        }
+        return container;
+    }
+
+    static Container fromWords(std::vector<uint64_t> words) {
+        Container container;
+        for (uint64_t word : words) {
+            container.cardinality += __builtin_popcountll(word);
+        }
+        container.kind = Container::Kind::bitmap;
+        container.words = std::move(words);
+        if (container.cardinality <= maxArraySize) {
+            container.values = valuesOf(container);
+            container.words = std::vector<uint64_t>();
+            container.kind = Container::Kind::array;
+        }
+        return container;
+    }
+
+    static Container combine(const Container& left, const Container& right, Operation operation) {
+        if (isSparse(left) && isSparse(right)) {
+            std::vector<uint16_t> a = valuesOf(left);
+            std::vector<uint16_t> b = valuesOf(right);
+            std::vector<uint16_t> result;
+            result.reserve(operation == Operation::intersection ? std::min(a.size(), b.size()) : a.size() + b.size());
+            auto out = std::back_inserter(result);
+            switch (operation) {
+                case Operation::union_:
+                    std::set_union(a.begin(), a.end(), b.begin(), b.end(), out);
+                    break;
+                case Operation::intersection:
+                    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), out);
+                    break;
+                case Operation::difference:
+                    std::set_difference(a.begin(), a.end(), b.begin(), b.end(), out);
+                    break;
+                case Operation::symmetricDifference:
+                    std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), out);
+                    break;
+            }
+            return fromValues(std::move(result));
+        }
+        // A sparse side of an intersection, or the sparse left side of a difference, only
+        // needs each of its members tested against the other container.
+        if ((operation == Operation::intersection && (isSparse(left) || isSparse(right))) ||
+            (operation == Operation::difference && isSparse(left))) {
+            bool leftIsProbe = isSparse(left);
+            const Container& probe = leftIsProbe ? left : right;
+            const Container& other = leftIsProbe ? right : left;
+            bool keepIfContained = operation == Operation::intersection;
+            std::vector<uint16_t> result;
+            forEachIn(probe, [&](uint16_t low) {
+                if (containerContains(other, low) == keepIfContained) {
+                    result.push_back(low);
+                }
+            });
+            return fromValues(std::move(result));
+        }
+        std::vector<uint64_t> words = wordsOf(left);
+        std::vector<uint64_t> rightWords = wordsOf(right);
+        for (size_t i = 0; i < bitmapWords; ++i) {
+            switch (operation) {
+                case Operation::union_:
+                    words[i] |= rightWords[i];
+                    break;
+                case Operation::intersection:
+                    words[i] &= rightWords[i];
+                    break;
+                case Operation::difference:
+                    words[i] &= ~rightWords[i];
+                    break;
+                case Operation::symmetricDifference:
+                    words[i] ^= rightWords[i];
+                    break;
+            }
+        }
+        return fromWords(std::move(words));
+    }
+
+    static bool intersects(const Container& left, const Container& right) {
+        if (isSparse(left) || isSparse(right)) {
+            const Container& probe = isSparse(left) ? left : right;
+            const Container& other = isSparse(left) ? right : left;
+            bool found = false;
+            forEachIn(probe, [&](uint16_t low) { found = found || containerContains(other, low); });
+            return found;
+        }
+        std::vector<uint64_t> leftWords = wordsOf(left);
+        std::vector<uint64_t> rightWords = wordsOf(right);
+        for (size_t i = 0; i < bitmapWords; ++i) {
+            if (leftWords[i] & rightWords[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static size_t runCount(const Container& container) {
+        if (container.kind == Container::Kind::run) {
+            return container.runs.size();
+        }
+        size_t runs = 0;
+        int64_t previous = -2;
+        forEachIn(container, [&](uint16_t low) {
+            runs += low != previous + 1;
+            previous = low;
+        });
+        return runs;
+    }
+
+    static RoaringSet combineSets(const RoaringSet& left, const RoaringSet& right, Operation operation) {
+        RoaringSet result;
+        size_t i = 0;
+        size_t j = 0;
+        bool keepLeftOnly = operation != Operation::intersection;
+        bool keepRightOnly = operation == Operation::union_ || operation == Operation::symmetricDifference;
+        while (i < left.keys.size() || j < right.keys.size()) {
+            if (j == right.keys.size() || (i < left.keys.size() && left.keys[i] < right.keys[j])) {
+                if (keepLeftOnly) {
+                    result.keys.push_back(left.keys[i]);
+                    result.containers.push_back(left.containers[i]);
+                }
+                ++i;
+            } else if (i == left.keys.size() || right.keys[j] < left.keys[i]) {
+                if (keepRightOnly) {
+                    result.keys.push_back(right.keys[j]);
+                    result.containers.push_back(right.containers[j]);
+                }
+                ++j;
+            } else {
+                Container combined = combine(left.containers[i], right.containers[j], operation);
+                if (combined.cardinality > 0) {
+                    result.keys.push_back(left.keys[i]);
+                    result.containers.push_back(std::move(combined));
+                }
+                ++i;
+                ++j;
+            }
+        }
+        return result;
+    }
+
+    // Index of the container for `key`, or -1 with `position` set to where it belongs.
+    std::ptrdiff_t findContainer(uint16_t key, size_t& position) const {
+        position = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+        return position < keys.size() && keys[position] == key ? static_cast<std::ptrdiff_t>(position) : -1;
+    }
+
+    // Serialization Helpers (little-endian regardless of the host)
+
+    static void put16(std::vector<uint8_t>& bytes, uint16_t value) {
+        bytes.push_back(value & 0xFF);
+        bytes.push_back(value >> 8);
+    }
+
+    static void put32(std::vector<uint8_t>& bytes, uint32_t value) {
+        put16(bytes, value & 0xFFFF);
+        put16(bytes, value >> 16);
+    }
+
+    static uint32_t read(const std::vector<uint8_t>& bytes, size_t& offset, size_t width) {
+        if (offset + width > bytes.size()) {
+            throw std::runtime_error("Truncated Roaring bitmap.");
+        }
+        uint32_t value = 0;
+        for (size_t i = 0; i < width; ++i) {
+            value |= uint32_t(bytes[offset + i]) << (8 * i);
+        }
+        offset += width;
+        return value;
+    }
+
+public:
+    RoaringSet() = default;
+
+    explicit RoaringSet(const std::vector<T>& elements) {
+        std::vector<uint32_t> bits(elements.size());
+        std::transform(elements.begin(), elements.end(), bits.begin(), toBits);
+        std::sort(bits.begin(), bits.end());
+        bits.erase(std::unique(bits.begin(), bits.end()), bits.end());
+        for (size_t begin = 0, end; begin < bits.size(); begin = end) {
+            std::vector<uint16_t> values;
+            for (end = begin; end < bits.size() && bits[end] >> 16 == bits[begin] >> 16; ++end) {
+                values.push_back(bits[end] & 0xFFFF);
+            }
+            keys.push_back(bits[begin] >> 16);
+            containers.push_back(fromValues(std::move(values)));
+        }
+    }
+
+    // Basic Set Operations
+
+    bool isEmpty() const {
+        return keys.empty();
+    }
+
+    int count() const {
+        size_t total = 0;
+        for (const Container& container : containers) {
+            total += container.cardinality;
+        }
+        return total;
+    }
+
+    void insert(const T& element) {
+        uint32_t bits = toBits(element);
+        uint16_t low = bits & 0xFFFF;
+        size_t position;
+        std::ptrdiff_t index = findContainer(bits >> 16, position);
+        if (index < 0) {
+            keys.insert(keys.begin() + position, bits >> 16);
+            containers.insert(containers.begin() + position, fromValues({low}));
+            return;
+        }
+        Container& container = containers[index];
+        if (containerContains(container, low)) {
+            return;
+        }
+        if (container.kind == Container::Kind::bitmap) {
+            container.words[low >> 6] |= uint64_t(1) << (low & 63);
+            ++container.cardinality;
+        } else if (container.kind == Container::Kind::array && container.cardinality < maxArraySize) {
+            container.values.insert(std::lower_bound(container.values.begin(), container.values.end(), low), low);
+            ++container.cardinality;
+        } else {
+            std::vector<uint16_t> values = valuesOf(container);
+            values.insert(std::lower_bound(values.begin(), values.end(), low), low);
+            container = fromValues(std::move(values));
+        }
+    }
+
+    bool remove(const T& element) {
+        uint32_t bits = toBits(element);
+        uint16_t low = bits & 0xFFFF;
+        size_t position;
+        std::ptrdiff_t index = findContainer(bits >> 16, position);
+        if (index < 0 || !containerContains(containers[index], low)) {
+            return false;
+        }
+        Container& container = containers[index];
+        if (container.kind == Container::Kind::bitmap) {
+            container.words[low >> 6] &= ~(uint64_t(1) << (low & 63));
+            if (--container.cardinality <= maxArraySize) {
+                container = fromWords(std::move(container.words));
+            }
+        } else if (container.kind == Container::Kind::array) {
+            container.values.erase(std::lower_bound(container.values.begin(), container.values.end(), low));
+            --container.cardinality;
+        } else {
+            std::vector<uint16_t> values = valuesOf(container);
+            values.erase(std::lower_bound(values.begin(), values.end(), low));
+            container = fromValues(std::move(values));
+        }
+        if (container.cardinality == 0) {
+            keys.erase(keys.begin() + index);
+            containers.erase(containers.begin() + index);
+        }
+        return true;
+    }
+
+    bool contains(const T& element) const {
+        uint32_t bits = toBits(element);
+        size_t position;
+        std::ptrdiff_t index = findContainer(bits >> 16, position);
+        return index >= 0 && containerContains(containers[index], bits & 0xFFFF);
+    }
+
+    // Set Operations
+
+    RoaringSet<T> unionWith(const RoaringSet<T>& otherSet) const {
+        return combineSets(*this, otherSet, Operation::union_);
+    }
+
+    RoaringSet<T> intersectionWith(const RoaringSet<T>& otherSet) const {
+        return combineSets(*this, otherSet, Operation::intersection);
+    }
+
+    RoaringSet<T> differenceWith(const RoaringSet<T>& otherSet) const {
+        return combineSets(*this, otherSet, Operation::difference);
+    }
+
+    RoaringSet<T> symmetricDifferenceWith(const RoaringSet<T>& otherSet) const {
+        return combineSets(*this, otherSet, Operation::symmetricDifference);
+    }
+
+    bool isSubsetOf(const RoaringSet<T>& otherSet) const {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            size_t position;
+            std::ptrdiff_t index = otherSet.findContainer(keys[i], position);
+            if (index < 0 || containers[i].cardinality > otherSet.containers[index].cardinality ||
+                combine(containers[i], otherSet.containers[index], Operation::difference).cardinality != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool isSupersetOf(const RoaringSet<T>& otherSet) const {
+        return otherSet.isSubsetOf(*this);
+    }
+
+    bool isDisjointWith(const RoaringSet<T>& otherSet) const {
+        size_t i = 0;
+        size_t j = 0;
+        while (i < keys.size() && j < otherSet.keys.size()) {
+            if (keys[i] < otherSet.keys[j]) {
+                ++i;
+            } else if (otherSet.keys[j] < keys[i]) {
+                ++j;
+            } else if (intersects(containers[i++], otherSet.containers[j++])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void forEach(void (*closure)(const T&)) const {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            uint32_t high = uint32_t(keys[i]) << 16;
+            forEachIn(containers[i], [closure, high](uint16_t low) { closure(fromBits(high | low)); });
+        }
+    }
+
+    void removeAll() {
+        keys.clear();
+        containers.clear();
+    }
+
+    void removeAllOccurrencesOf(const T& element) {
+        remove(element);
+    }
+
+    void formUnionWith(const RoaringSet<T>& otherSet) {
+        *this = unionWith(otherSet);
+    }
+
+    void formIntersectionWith(const RoaringSet<T>& otherSet) {
+        *this = intersectionWith(otherSet);
+    }
+
+    void subtract(const RoaringSet<T>& otherSet) {
+        *this = differenceWith(otherSet);
+    }
+
+    // Compression
+
+    /// Store each chunk as runs where that is smaller than its array or bitmap, and turn
+    /// run containers back into arrays or bitmaps where it is not. Returns whether any
+    /// run containers remain.
+    bool runOptimize() {
+        bool hasRuns = false;
+        for (Container& container : containers) {
+            size_t runs = runCount(container);
+            size_t plainBytes = container.cardinality <= maxArraySize ? 2 * container.cardinality : 8 * bitmapWords;
+            if (2 + 4 * runs < plainBytes) {
+                if (container.kind != Container::Kind::run) {
+                    Container converted;
+                    converted.kind = Container::Kind::run;
+                    converted.cardinality = container.cardinality;
+                    forEachIn(container, [&converted](uint16_t low) {
+                        Run* last = converted.runs.empty() ? nullptr : &converted.runs.back();
+                        if (last != nullptr && uint32_t(last->start) + last->length + 1 == low) {
+                            ++last->length;
+                        } else {
+                            converted.runs.push_back({low, 0});
+                        }
+                    });
+                    container = std::move(converted);
+                }
+                hasRuns = true;
+            } else if (container.kind == Container::Kind::run) {
+                container = fromValues(valuesOf(container));
+            }
+        }
+        return hasRuns;
+    }
+
+    /// Heap bytes held by the containers (not counting vector headers).
+    size_t sizeInBytes() const {
+        size_t bytes = keys.capacity() * sizeof(uint16_t) + containers.capacity() * sizeof(Container);
+        for (const Container& container : containers) {
+            bytes += container.values.capacity() * sizeof(uint16_t) + container.words.capacity() * sizeof(uint64_t) +
+                     container.runs.capacity() * sizeof(Run);
+        }
+        return bytes;
+    }
+
+    // Serialization
+
+    /// Encode in the portable Roaring format (https://github.com/RoaringBitmap/RoaringFormatSpec).
+    /// Call runOptimize() first to make use of run containers.
+    std::vector<uint8_t> serialize() const {
+        size_t containerCount = containers.size();
+        bool hasRuns = std::any_of(containers.begin(), containers.end(),
+                                   [](const Container& container) { return container.kind == Container::Kind::run; });
+        std::vector<uint8_t> bytes;
+        if (hasRuns) {
+            put32(bytes, cookieWithRuns | uint32_t(containerCount - 1) << 16);
+            size_t runFlags = bytes.size();
+            bytes.resize(runFlags + (containerCount + 7) / 8, 0);
+            for (size_t i = 0; i < containerCount; ++i) {
+                if (containers[i].kind == Container::Kind::run) {
+                    bytes[runFlags + i / 8] |= 1 << (i % 8);
+                }
+            }
+        } else {
+            put32(bytes, cookieWithoutRuns);
+            put32(bytes, containerCount);
+        }
+        for (size_t i = 0; i < containerCount; ++i) {
+            put16(bytes, keys[i]);
+            put16(bytes, containers[i].cardinality - 1);
+        }
+
+        bool hasOffsets = !hasRuns || containerCount >= offsetThreshold;
+        size_t offsetsAt = bytes.size();
+        if (hasOffsets) {
+            bytes.resize(bytes.size() + 4 * containerCount);
+        }
+        for (size_t i = 0; i < containerCount; ++i) {
+            if (hasOffsets) {
+                uint32_t offset = bytes.size();
+                for (size_t byte = 0; byte < 4; ++byte) {
+                    bytes[offsetsAt + 4 * i + byte] = (offset >> (8 * byte)) & 0xFF;
+                }
+            }
+            const Container& container = containers[i];
+            if (container.kind == Container::Kind::run) {
+                put16(bytes, container.runs.size());
+                for (const Run& run : container.runs) {
+                    put16(bytes, run.start);
+                    put16(bytes, run.length);
+                }
+            } else if (container.cardinality <= maxArraySize) {
+                forEachIn(container, [&bytes](uint16_t low) { put16(bytes, low); });
+            } else {
+                for (uint64_t word : wordsOf(container)) {
+                    put32(bytes, word & 0xFFFFFFFF);
+                    put32(bytes, word >> 32);
+                }
+            }
+        }
+        return bytes;
+    }
+
+    /// Decode the portable Roaring format. Throws std::runtime_error on malformed input.
+    static RoaringSet deserialize(const std::vector<uint8_t>& bytes) {
+        size_t offset = 0;
+        uint32_t cookie = read(bytes, offset, 4);
+        size_t containerCount;
+        std::vector<uint8_t> runFlags;
+        bool hasRuns = (cookie & 0xFFFF) == cookieWithRuns;
+        if (hasRuns) {
+            containerCount = (cookie >> 16) + 1;
+            for (size_t i = 0; i < (containerCount + 7) / 8; ++i) {
+                runFlags.push_back(read(bytes, offset, 1));
+            }
+        } else if (cookie == cookieWithoutRuns) {
+            containerCount = read(bytes, offset, 4);
+        } else {
+            throw std::runtime_error("Not a Roaring bitmap.");
+        }
+        if (containerCount > 65536) {
+            throw std::runtime_error("Malformed Roaring bitmap.");
+        }
+
+        RoaringSet set;
+        std::vector<uint32_t> cardinalities(containerCount);
+        for (size_t i = 0; i < containerCount; ++i) {
+            set.keys.push_back(read(bytes, offset, 2));
+            cardinalities[i] = read(bytes, offset, 2) + 1;
+            if (i > 0 && set.keys[i] <= set.keys[i - 1]) {
+                throw std::runtime_error("Malformed Roaring bitmap.");
+            }
+        }
+        if (!hasRuns || containerCount >= offsetThreshold) {
+            offset += 4 * containerCount;  // the offsets only allow random access; we read in order
+        }
+        for (size_t i = 0; i < containerCount; ++i) {
+            Container container;
+            if (hasRuns && (runFlags[i / 8] >> (i % 8)) & 1) {
+                container.kind = Container::Kind::run;
+                size_t runs = read(bytes, offset, 2);
+                int64_t previousEnd = -1;
+                for (size_t run = 0; run < runs; ++run) {
+                    uint16_t start = read(bytes, offset, 2);
+                    uint16_t length = read(bytes, offset, 2);
+                    if (start <= previousEnd || uint32_t(start) + length > 0xFFFF) {
+                        throw std::runtime_error("Malformed Roaring bitmap.");
+                    }
+                    container.runs.push_back({start, length});
+                    container.cardinality += uint32_t(length) + 1;
+                    previousEnd = start + length;
+                }
+            } else if (cardinalities[i] <= maxArraySize) {
+                for (size_t value = 0; value < cardinalities[i]; ++value) {
+                    container.values.push_back(read(bytes, offset, 2));
+                    if (value > 0 && container.values[value] <= container.values[value - 1]) {
+                        throw std::runtime_error("Malformed Roaring bitmap.");
+                    }
+                }
+                container.cardinality = cardinalities[i];
+            } else {
+                std::vector<uint64_t> words(bitmapWords);
+                for (uint64_t& word : words) {
+                    word = read(bytes, offset, 4);
+                    word |= uint64_t(read(bytes, offset, 4)) << 32;
+                }
+                container = fromWords(std::move(words));
+            }
+            if (container.cardinality != cardinalities[i]) {
+                throw std::runtime_error("Malformed Roaring bitmap.");
+            }
+            set.containers.push_back(std::move(container));
+        }
+        return set;
+    }
+};
+
+// Benchmark
+
+// Written by benchmarks so the optimizer cannot drop the measured loops.
+volatile size_t benchmarkSink = 0;
+
+// Live and peak bytes allocated through CountingAllocator, which the memory benchmarks
+// give to the table or vector backing the sets they measure.
+std::atomic<size_t> liveBytes{0};
+std::atomic<size_t> peakBytes{0};
+
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+
+    T* allocate(size_t count) {
+        size_t live = liveBytes.fetch_add(count * sizeof(T), std::memory_order_relaxed) + count * sizeof(T);
+        size_t peak = peakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+        return std::allocator<T>().allocate(count);
+    }
+
+    void deallocate(T* pointer, size_t count) {
+        liveBytes.fetch_sub(count * sizeof(T), std::memory_order_relaxed);
+        std::allocator<T>().deallocate(pointer, count);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>&) const {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const CountingAllocator<U>&) const {
+        return false;
+    }
+};
+
+using CountedCustomSet = CustomSet<uint32_t, CountingAllocator<std::pair<const uint32_t, bool>>>;
+using CountedSortedFlatSet = SortedFlatSet<uint32_t, CountingAllocator<uint32_t>>;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// Heap bytes per element held by the set built by `build`, which allocates through
+/// CountingAllocator.
+template <typename Build>
+double bytesPerElement(Build build) {
+    size_t before = liveBytes.load();
+    auto set = build();
+    size_t held = liveBytes.load() - before;
+    benchmarkSink = set.count();
+    return static_cast<double>(held) / set.count();
+}
+
+CountedCustomSet countedHashed(const std::vector<uint32_t>& ids) {
+    CountedCustomSet set;
+    for (uint32_t id : ids) {
+        set.insert(id);
+    }
+    return set;
+}
+
+CountedSortedFlatSet countedFlat(const std::vector<uint32_t>& ids) {
+    return CountedSortedFlatSet(std::vector<uint32_t, CountingAllocator<uint32_t>>(ids.begin(), ids.end()));
+}
+
+template <typename Set>
+void timeSetAlgebra(const char* name, const Set& left, const Set& right, const std::vector<uint32_t>& probes) {
+    auto start = std::chrono::steady_clock::now();
+    size_t found = 0;
+    for (uint32_t probe : probes) {
+        found += left.contains(probe);
+    }
+    double containsSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    size_t total = left.unionWith(right).count();
+    double unionSeconds = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    total += left.intersectionWith(right).count();
+    double intersectionSeconds = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    total += left.differenceWith(right).count();
+    double differenceSeconds = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    total += left.symmetricDifferenceWith(right).count();
+    double symmetricSeconds = secondsSince(start);
+    benchmarkSink = found + total;
+
+    std::cout << "  " << name << ": contains " << probes.size() / containsSeconds / 1e6 << " M/s; union "
+              << unionSeconds << " s, intersection " << intersectionSeconds << " s, difference "
+              << differenceSeconds << " s, symmetric difference " << symmetricSeconds << " s" << std::endl;
+}
+
+void benchmarkSortedFlatSet() {
+    // Ordered IDs: two overlapping sets of 1M random IDs below 4M.
+    const size_t elementCount = 1 << 20;
+    std::mt19937 random(3);
+    std::vector<uint32_t> leftIds(elementCount);
+    std::vector<uint32_t> rightIds(elementCount);
+    for (size_t i = 0; i < elementCount; ++i) {
+        leftIds[i] = random() % (4 * elementCount);
+        rightIds[i] = random() % (4 * elementCount);
+    }
+    std::vector<uint32_t> probes(elementCount);
+    for (uint32_t& probe : probes) {
+        probe = random() % (4 * elementCount);
+    }
+
+    auto buildHashed = [](const std::vector<uint32_t>& ids) {
+        CustomSet<uint32_t> set;
+        for (uint32_t id : ids) {
+            set.insert(id);
+        }
+        return set;
+    };
+    auto buildFlat = [](const std::vector<uint32_t>& ids) { return SortedFlatSet<uint32_t>(ids); };
+
+    std::cout << "Heap bytes per element for 1M IDs: CustomSet "
+              << bytesPerElement([&] { return countedHashed(leftIds); }) << ", SortedFlatSet "
+              << bytesPerElement([&] { return countedFlat(leftIds); }) << std::endl;
+
+    std::cout << "Set algebra on two 1M-ID sets" << std::endl;
+    timeSetAlgebra("CustomSet", buildHashed(leftIds), buildHashed(rightIds), probes);
+    timeSetAlgebra("SortedFlatSet", buildFlat(leftIds), buildFlat(rightIds), probes);
+}
+
+/// Runs `operation` on a fresh copy of `set` and reports its time and the heap it used
+/// beyond what was live when it started.
+template <typename Set, typename Operation>
+void measureCompound(const char* name, const Set& set, Operation operation) {
+    Set target(set);
+    size_t before = liveBytes.load();
+    peakBytes.store(before);
+    auto start = std::chrono::steady_clock::now();
+    operation(target);
+    double seconds = secondsSince(start);
+    benchmarkSink = target.count();
+    std::cout << " " << name << " " << seconds << " s, " << (peakBytes.load() - before) / 1e6 << " MB peak;";
+}
+
+void benchmarkCompoundOperations() {
+    // Two 1M-element sets sharing half their elements.
+    const uint32_t elementCount = 1 << 20;
+    using Set = CountedCustomSet;
+    Set left;
+    Set right;
+    for (uint32_t i = 0; i < elementCount; ++i) {
+        left.insert(i);
+        right.insert(i + elementCount / 2);
+    }
+
+    std::cout << "Compound operations on two 1M-element CustomSets (copy-and-assign vs in place)" << std::endl;
+    std::cout << "  union:";
+    measureCompound("copy", left, [&](Set& set) { set = set.unionWith(right); });
+    measureCompound("in place", left, [&](Set& set) { set.formUnionWith(right); });
+    std::cout << std::endl << "  intersection:";
+    measureCompound("copy", left, [&](Set& set) { set = set.intersectionWith(right); });
+    measureCompound("in place", left, [&](Set& set) { set.formIntersectionWith(right); });
+    std::cout << std::endl << "  subtract:";
+    measureCompound("copy", left, [&](Set& set) { set = set.differenceWith(right); });
+    measureCompound("in place", left, [&](Set& set) { set.subtract(right); });
+    std::cout << std::endl << "  symmetric difference:";
+    measureCompound("three sets", left,
+                    [&](Set& set) { set = set.differenceWith(right).unionWith(right.differenceWith(set)); });
+    measureCompound("in place", left, [&](Set& set) { set.formSymmetricDifferenceWith(right); });
+    std::cout << std::endl;
+}
+
+void benchmarkParallelSetAlgebra() {
+    // Two 2M-element sets sharing half their elements. The subset and disjointness probes
+    // each hinge on a single element, so they scan until some thread reaches it.
+    const uint32_t elementCount = 2 << 20;
+    CustomSet<uint32_t> left;
+    CustomSet<uint32_t> right;
+    for (uint32_t i = 0; i < elementCount; ++i) {
+        left.insert(i);
+        right.insert(i + elementCount / 2);
+    }
+    CustomSet<uint32_t> almostSubset = left.intersectionWith(right);
+    almostSubset.insert(0);
+    CustomSet<uint32_t> almostDisjoint;
+    for (uint32_t i = 0; i < elementCount / 2; ++i) {
+        almostDisjoint.insert(2 * elementCount + i);
+    }
+    almostDisjoint.insert(elementCount - 1);
+
+    size_t coreCount = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < coreCount; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(coreCount);
+
+    auto time = [](auto operation) {
+        auto start = std::chrono::steady_clock::now();
+        benchmarkSink = operation();
+        return secondsSince(start);
+    };
+    std::cout << "Set algebra on two 2M-element CustomSets, seconds" << std::endl;
+    std::cout << "  serial: union " << time([&] { return left.unionWith(right).count(); }) << ", intersection "
+              << time([&] { return left.intersectionWith(right).count(); }) << ", difference "
+              << time([&] { return left.differenceWith(right).count(); }) << ", isSubsetOf "
+              << time([&] { return almostSubset.isSubsetOf(right); }) << ", isDisjointWith "
+              << time([&] { return almostDisjoint.isDisjointWith(left); }) << std::endl;
+    for (size_t threads : threadCounts) {
+        ThreadPool pool(threads);
+        std::cout << "  threads=" << threads << ": union " << time([&] { return left.unionWith(right, pool).count(); })
+                  << ", intersection " << time([&] { return left.intersectionWith(right, pool).count(); })
+                  << ", difference " << time([&] { return left.differenceWith(right, pool).count(); })
+                  << ", isSubsetOf " << time([&] { return almostSubset.isSubsetOf(right, pool); })
+                  << ", isDisjointWith " << time([&] { return almostDisjoint.isDisjointWith(left, pool); }) << std::endl;
+    }
+    if (coreCount == 1) {
+        std::cout << "  (one hardware thread here: multi-core speedup not measured)" << std::endl;
+    }
+}
+
+/// Clustered IDs, as entity filters see them: dense runs of consecutive IDs separated by gaps.
+std::vector<uint32_t> clusteredIds(size_t elementCount, std::mt19937& random) {
+    std::vector<uint32_t> ids;
+    ids.reserve(elementCount);
+    uint32_t next = 0;
+    while (ids.size() < elementCount) {
+        next += random() % 4096;
+        for (size_t length = 1 + random() % 2048; length > 0 && ids.size() < elementCount; --length) {
+            if (random() % 8 != 0) {
+                ids.push_back(next);
+            }
+            ++next;
+        }
+    }
+    return ids;
+}
+
+void benchmarkRoaringSet() {
+    const size_t elementCount = 4 << 20;
+    std::mt19937 random(5);
+    std::vector<uint32_t> leftIds = clusteredIds(elementCount, random);
+    std::vector<uint32_t> rightIds = clusteredIds(elementCount, random);
+    std::vector<uint32_t> probes(elementCount);
+    for (uint32_t& probe : probes) {
+        probe = random() % leftIds.back();
+    }
+
+    auto buildHashed = [](const std::vector<uint32_t>& ids) {
+        CustomSet<uint32_t> set;
+        for (uint32_t id : ids) {
+            set.insert(id);
+        }
+        return set;
+    };
+    auto buildFlat = [](const std::vector<uint32_t>& ids) { return SortedFlatSet<uint32_t>(ids); };
+    auto buildRoaring = [](const std::vector<uint32_t>& ids) { return RoaringSet<uint32_t>(ids); };
+
+    RoaringSet<uint32_t> roaring = buildRoaring(leftIds);
+    std::cout << "Heap bytes per element for 4M clustered IDs: CustomSet "
+              << bytesPerElement([&] { return countedHashed(leftIds); }) << ", SortedFlatSet "
+              << bytesPerElement([&] { return countedFlat(leftIds); }) << ", RoaringSet "
+              << static_cast<double>(roaring.sizeInBytes()) / roaring.count() << std::endl;
+
+    size_t plainBytes = roaring.serialize().size();
+    roaring.runOptimize();
+    std::cout << "RoaringSet serialized: " << plainBytes << " bytes, " << roaring.serialize().size()
+              << " bytes after runOptimize()" << std::endl;
+
+    std::cout << "Set algebra on two 4M-ID clustered sets" << std::endl;
+    timeSetAlgebra("CustomSet", buildHashed(leftIds), buildHashed(rightIds), probes);
+    timeSetAlgebra("SortedFlatSet", buildFlat(leftIds), buildFlat(rightIds), probes);
+    timeSetAlgebra("RoaringSet", buildRoaring(leftIds), buildRoaring(rightIds), probes);
+}
+
 // Example usage
-int main() {
+int main(int argc, char* argv[]) {
     CustomSet<int> set1;
     set1.insert(1);
     set1.insert(2);
@@ -140,5 +1622,27 @@ int main() {
     });
     std::cout << std::endl;
 
+    SortedFlatSet<int> sortedSet({5, 1, 3, 3});
+    std::cout << "Sorted set:";
+    for (int element : sortedSet.symmetricDifferenceWith(SortedFlatSet<int>({3, 4}))) {
+        std::cout << " " << element;
+    }
+    std::cout << std::endl;
+
+    RoaringSet<uint32_t> bitmap({7, 65536, 65537, 1 << 20});
+    bitmap.insert(8);
+    std::cout << "Roaring set:";
+    RoaringSet<uint32_t>::deserialize(bitmap.serialize()).forEach([](const uint32_t& element) {
+        std::cout << " " << element;
+    });
+    std::cout << std::endl;
+
+    if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+        benchmarkSortedFlatSet();
+        benchmarkRoaringSet();
+        benchmarkCompoundOperations();
+        benchmarkParallelSetAlgebra();
+    }
+
     return 0;
 }
@@ -0,0 +1,581 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+
+#include "stableHashing.h"
+
+// Fixed-size summaries of huge sets. A HyperLogLog answers "how many distinct elements?"
+// and a MinHash answers "how similar are these two sets?", each in a few KB however many
+// elements it has seen, and two sketches of the same kind merge into a sketch of the
+// union. They can be built from any range (CustomSet, CustomArray, std containers) or fed
+// one element at a time from a stream.
+
+// HyperLogLog
+
+// HyperLogLog with 2^precision one-byte registers (precision 12: 4 KB, about 1.6% standard
+// error). Like HyperLogLog++ it starts in a sparse mode that records (index, rank) pairs
+// at precision 25, which is far more accurate for small sets, and switches to the dense
+// registers once the pairs would take more room than the registers. Dense estimates use
+// Ertl's improved estimator, which is unbiased across the whole range without the
+// empirical bias tables of HyperLogLog++.
+class HyperLogLog {
+private:
+    static constexpr uint32_t magic = 0x314c4c48;  // "HLL1"
+    static constexpr int sparsePrecision = 25;
+
+    int precision;
+    bool sparse = true;
+    std::vector<uint32_t> sparseEntries;  // sorted by index: index << 6 | rank, one per index
+    std::vector<uint32_t> pending;        // unsorted additions, folded in when full
+    std::vector<uint8_t> registers;
+
+    size_t registerCount() const {
+        return size_t(1) << precision;
+    }
+
+    size_t sparseLimit() const {
+        return registerCount() / sizeof(uint32_t);
+    }
+
+    // Rank of the bits after the first `indexBits`: the position of the first set bit,
+    // counting from 1, or 65 - indexBits if they are all zero.
+    static uint32_t rankAfter(uint64_t hash, int indexBits) {
+        uint64_t rest = hash << indexBits;
+        return rest == 0 ? 65 - indexBits : __builtin_clzll(rest) + 1;
+    }
+
+    static uint32_t sparseEntryOf(uint64_t hash) {
+        return static_cast<uint32_t>(hash >> (64 - sparsePrecision)) << 6 | rankAfter(hash, sparsePrecision);
+    }
+
+    // The dense register and rank a sparse entry maps to at `precision`.
+    void foldIntoRegisters(uint32_t entry) {
+        uint32_t sparseIndex = entry >> 6;
+        int extraBits = sparsePrecision - precision;
+        uint32_t index = sparseIndex >> extraBits;
+        uint32_t between = sparseIndex & ((uint32_t(1) << extraBits) - 1);
+        uint32_t rank = between != 0 ? __builtin_clz(between) - (32 - extraBits) + 1 : extraBits + (entry & 63);
+        registers[index] = std::max<uint8_t>(registers[index], rank);
+    }
+
+    void flushPending() {
+        if (pending.empty()) {
+            return;
+        }
+        std::sort(pending.begin(), pending.end());
+        std::vector<uint32_t> merged;
+        merged.reserve(sparseEntries.size() + pending.size());
+        std::merge(sparseEntries.begin(), sparseEntries.end(), pending.begin(), pending.end(),
+                   std::back_inserter(merged));
+        // Entries sort by index, then rank, so the last entry of each index has its top rank.
+        sparseEntries.clear();
+        for (size_t i = 0; i < merged.size(); ++i) {
+            if (i + 1 == merged.size() || merged[i] >> 6 != merged[i + 1] >> 6) {
+                sparseEntries.push_back(merged[i]);
+            }
+        }
+        pending.clear();
+        if (sparseEntries.size() > sparseLimit()) {
+            convertToDense();
+        }
+    }
+
+    void convertToDense() {
+        registers.assign(registerCount(), 0);
+        for (uint32_t entry : sparseEntries) {
+            foldIntoRegisters(entry);
+        }
+        for (uint32_t entry : pending) {
+            foldIntoRegisters(entry);
+        }
+        sparse = false;
+        sparseEntries = std::vector<uint32_t>();
+        pending = std::vector<uint32_t>();
+    }
+
+    // sigma and tau from Ertl, "New cardinality estimation algorithms for HyperLogLog
+    // sketches" (2017), evaluated to full double precision.
+    static double sigma(double x) {
+        if (x == 1) {
+            return std::numeric_limits<double>::infinity();
+        }
+        double y = 1;
+        double z = x;
+        for (double previous = -1; z != previous;) {
+            x *= x;
+            previous = z;
+            z += x * y;
+            y += y;
+        }
+        return z;
+    }
+
+    static double tau(double x) {
+        if (x == 0 || x == 1) {
+            return 0;
+        }
+        double y = 1;
+        double z = 1 - x;
+        for (double previous = -1; z != previous;) {
+            x = std::sqrt(x);
+            previous = z;
+            y *= 0.5;
+            z -= (1 - x) * (1 - x) * y;
+        }
+        return z / 3;
+    }
+
+public:
+    explicit HyperLogLog(int precision = 12) : precision(precision) {
+        if (precision < 4 || precision > 18) {
+            throw std::runtime_error("HyperLogLog precision must be between 4 and 18.");
+        }
+    }
+
+    template <typename Element>
+    void add(const Element& element) {
+        uint64_t hash = stableHash(element);
+        if (!sparse) {
+            size_t index = hash >> (64 - precision);
+            registers[index] = std::max<uint8_t>(registers[index], rankAfter(hash, precision));
+            return;
+        }
+        pending.push_back(sparseEntryOf(hash));
+        if (pending.size() >= sparseLimit()) {
+            flushPending();
+        }
+    }
+
+    template <typename Iterator>
+    void addAll(Iterator first, Iterator last) {
+        for (; first != last; ++first) {
+            add(*first);
+        }
+    }
+
+    /// Any range with begin()/end(): CustomSet, CustomArray, std containers.
+    template <typename Range>
+    void addAll(const Range& elements) {
+        addAll(std::begin(elements), std::end(elements));
+    }
+
+    /// Folds `other` in, so this sketch describes the union of both inputs. Both sketches
+    /// must have the same precision.
+    void merge(const HyperLogLog& other) {
+        if (other.precision != precision) {
+            throw std::runtime_error("Cannot merge HyperLogLog sketches of different precision.");
+        }
+        if (sparse && other.sparse) {
+            pending.insert(pending.end(), other.sparseEntries.begin(), other.sparseEntries.end());
+            pending.insert(pending.end(), other.pending.begin(), other.pending.end());
+            flushPending();
+            return;
+        }
+        if (sparse) {
+            convertToDense();
+        }
+        if (other.sparse) {
+            for (uint32_t entry : other.sparseEntries) {
+                foldIntoRegisters(entry);
+            }
+            for (uint32_t entry : other.pending) {
+                foldIntoRegisters(entry);
+            }
+        } else {
+            for (size_t i = 0; i < registers.size(); ++i) {
+                registers[i] = std::max(registers[i], other.registers[i]);
+            }
+        }
+    }
+
+    /// Estimated number of distinct elements added.
+    double estimate() const {
+        if (sparse && !pending.empty()) {
+            HyperLogLog flushed(*this);
+            flushed.flushPending();
+            return flushed.estimate();
+        }
+        if (sparse) {
+            // Linear counting over the 2^25 sparse indices is exact enough at this size.
+            double indexCount = static_cast<double>(uint64_t(1) << sparsePrecision);
+            return indexCount * std::log(indexCount / (indexCount - sparseEntries.size()));
+        }
+        int maxRank = 65 - precision;
+        std::vector<size_t> histogram(maxRank + 1, 0);
+        for (uint8_t rank : registers) {
+            ++histogram[rank];
+        }
+        double m = static_cast<double>(registerCount());
+        double z = m * tau(1 - histogram[maxRank] / m);
+        for (int rank = maxRank - 1; rank >= 1; --rank) {
+            z = 0.5 * (z + histogram[rank]);
+        }
+        z += m * sigma(histogram[0] / m);
+        return m * m / (2 * std::log(2.0)) / z;
+    }
+
+    /// Estimated size of the union of both inputs, without modifying either sketch.
+    double estimateUnionWith(const HyperLogLog& other) const {
+        HyperLogLog combined(*this);
+        combined.merge(other);
+        return combined.estimate();
+    }
+
+    /// Estimated size of the intersection, by inclusion-exclusion. Its error is that of
+    /// the union, so it is only meaningful when the overlap is a sizeable share of it.
+    double estimateIntersectionWith(const HyperLogLog& other) const {
+        return std::max(0.0, estimate() + other.estimate() - estimateUnionWith(other));
+    }
+
+    bool isSparse() const {
+        return sparse;
+    }
+
+    size_t sizeInBytes() const {
+        return registers.size() + (sparseEntries.size() + pending.size()) * sizeof(uint32_t);
+    }
+
+    // Serialization
+
+    std::vector<uint8_t> serialize() const {
+        HyperLogLog flushed(*this);
+        if (flushed.sparse) {
+            flushed.flushPending();
+        }
+        std::vector<uint8_t> bytes;
+        appendBytes(bytes, magic, 4);
+        appendBytes(bytes, 1, 4);
+        appendBytes(bytes, precision, 1);
+        appendBytes(bytes, flushed.sparse, 1);
+        if (flushed.sparse) {
+            appendBytes(bytes, flushed.sparseEntries.size(), 4);
+            for (uint32_t entry : flushed.sparseEntries) {
+                appendBytes(bytes, entry, 4);
+            }
+        } else {
+            bytes.insert(bytes.end(), flushed.registers.begin(), flushed.registers.end());
+        }
+        return bytes;
+    }
+
+    static HyperLogLog deserialize(const std::vector<uint8_t>& bytes) {
+        size_t offset = 0;
+        if (readBytes(bytes, offset, 4) != magic || readBytes(bytes, offset, 4) != 1) {
+            throw std::runtime_error("Not a version 1 HyperLogLog sketch.");
+        }
+        HyperLogLog sketch(static_cast<int>(readBytes(bytes, offset, 1)));
+        sketch.sparse = readBytes(bytes, offset, 1) != 0;
+        int maxRank = 65 - sketch.precision;
+        if (sketch.sparse) {
+            size_t entryCount = readBytes(bytes, offset, 4);
+            if (entryCount > sketch.sparseLimit() || bytes.size() - offset != entryCount * 4) {
+                throw std::runtime_error("HyperLogLog sketch size does not match its header.");
+            }
+            for (size_t i = 0; i < entryCount; ++i) {
+                uint32_t entry = static_cast<uint32_t>(readBytes(bytes, offset, 4));
+                uint32_t rank = entry & 63;
+                if (rank == 0 || rank > 65 - sparsePrecision || entry >> (6 + sparsePrecision) != 0 ||
+                    (i > 0 && entry >> 6 <= sketch.sparseEntries.back() >> 6)) {
+                    throw std::runtime_error("Malformed HyperLogLog sparse entry.");
+                }
+                sketch.sparseEntries.push_back(entry);
+            }
+        } else {
+            if (bytes.size() - offset != sketch.registerCount()) {
+                throw std::runtime_error("HyperLogLog sketch size does not match its header.");
+            }
+            sketch.registers.assign(bytes.begin() + offset, bytes.end());
+            if (std::any_of(sketch.registers.begin(), sketch.registers.end(),
+                            [maxRank](uint8_t rank) { return rank > maxRank; })) {
+                throw std::runtime_error("Malformed HyperLogLog register.");
+            }
+        }
+        return sketch;
+    }
+};
+
+// MinHash
+
+// Bottom-k MinHash: keeps the k smallest distinct element hashes (k = 256: 2 KB). The k
+// smallest hashes of a union are a uniform sample of it, so the share of that sample
+// present in both sketches estimates the Jaccard similarity |A ∩ B| / |A ∪ B| with
+// standard error about sqrt(J(1 - J) / k). The k-th smallest hash also estimates the
+// number of distinct elements.
+class MinHash {
+private:
+    static constexpr uint32_t magic = 0x31484e4d;  // "MNH1"
+
+    size_t capacity;
+    std::vector<uint64_t> smallest;  // sorted, distinct, at most `capacity` hashes
+
+    void offer(uint64_t hash) {
+        if (smallest.size() == capacity && hash >= smallest.back()) {
+            return;
+        }
+        auto position = std::lower_bound(smallest.begin(), smallest.end(), hash);
+        if (position != smallest.end() && *position == hash) {
+            return;
+        }
+        smallest.insert(position, hash);
+        if (smallest.size() > capacity) {
+            smallest.pop_back();
+        }
+    }
+
+    // Bottom-k of the union of both sketches.
+    std::vector<uint64_t> unionSample(const MinHash& other) const {
+        std::vector<uint64_t> merged;
+        std::set_union(smallest.begin(), smallest.end(), other.smallest.begin(), other.smallest.end(),
+                       std::back_inserter(merged));
+        if (merged.size() > capacity) {
+            merged.resize(capacity);
+        }
+        return merged;
+    }
+
+    static double estimateFrom(const std::vector<uint64_t>& sample, size_t capacity) {
+        if (sample.size() < capacity) {
+            return static_cast<double>(sample.size());  // every distinct element is in the sample
+        }
+        // The k-th smallest of n uniform hashes sits near k / n of the way through the range.
+        return (capacity - 1) / (static_cast<double>(sample.back()) / 18446744073709551616.0);
+    }
+
+    struct Unreserved {};
+
+    // Skips reserving room for `capacity` hashes, which deserialize cannot trust up front.
+    MinHash(size_t capacity, Unreserved) : capacity(capacity) {
+        if (capacity < 2) {
+            throw std::runtime_error("MinHash needs room for at least two hashes.");
+        }
+    }
+
+public:
+    explicit MinHash(size_t capacity = 256) : MinHash(capacity, Unreserved()) {
+        smallest.reserve(capacity + 1);
+    }
+
+    template <typename Element>
+    void add(const Element& element) {
+        offer(stableHash(element));
+    }
+
+    template <typename Iterator>
+    void addAll(Iterator first, Iterator last) {
+        for (; first != last; ++first) {
+            add(*first);
+        }
+    }
+
+    /// Any range with begin()/end(): CustomSet, CustomArray, std containers.
+    template <typename Range>
+    void addAll(const Range& elements) {
+        addAll(std::begin(elements), std::end(elements));
+    }
+
+    /// Folds `other` in, so this sketch describes the union of both inputs. Both sketches
+    /// must keep the same number of hashes.
+    void merge(const MinHash& other) {
+        if (other.capacity != capacity) {
+            throw std::runtime_error("Cannot merge MinHash sketches of different sizes.");
+        }
+        smallest = unionSample(other);
+    }
+
+    /// Estimated Jaccard similarity |A ∩ B| / |A ∪ B| of the two inputs.
+    double jaccard(const MinHash& other) const {
+        if (other.capacity != capacity) {
+            throw std::runtime_error("Cannot compare MinHash sketches of different sizes.");
+        }
+        std::vector<uint64_t> sample = unionSample(other);
+        if (sample.empty()) {
+            return 1;
+        }
+        size_t shared = 0;
+        for (uint64_t hash : sample) {
+            shared += std::binary_search(smallest.begin(), smallest.end(), hash) &&
+                      std::binary_search(other.smallest.begin(), other.smallest.end(), hash);
+        }
+        return static_cast<double>(shared) / sample.size();
+    }
+
+    /// Estimated number of distinct elements added.
+    double estimate() const {
+        return estimateFrom(smallest, capacity);
+    }
+
+    double estimateUnionWith(const MinHash& other) const {
+        return estimateFrom(unionSample(other), capacity);
+    }
+
+    double estimateIntersectionWith(const MinHash& other) const {
+        return jaccard(other) * estimateUnionWith(other);
+    }
+
+    size_t sizeInBytes() const {
+        return smallest.capacity() * sizeof(uint64_t);
+    }
+
+    // Serialization
+
+    std::vector<uint8_t> serialize() const {
+        std::vector<uint8_t> bytes;
+        appendBytes(bytes, magic, 4);
+        appendBytes(bytes, 1, 4);
+        appendBytes(bytes, capacity, 4);
+        appendBytes(bytes, smallest.size(), 4);
+        for (uint64_t hash : smallest) {
+            appendBytes(bytes, hash, 8);
+        }
+        return bytes;
+    }
+
+    static MinHash deserialize(const std::vector<uint8_t>& bytes) {
+        size_t offset = 0;
+        if (readBytes(bytes, offset, 4) != magic || readBytes(bytes, offset, 4) != 1) {
+            throw std::runtime_error("Not a version 1 MinHash sketch.");
+        }
+        size_t capacity = readBytes(bytes, offset, 4);
+        size_t hashCount = readBytes(bytes, offset, 4);
+        if (hashCount > capacity || bytes.size() - offset != hashCount * 8) {
+            throw std::runtime_error("MinHash sketch size does not match its header.");
+        }
+        // Memory follows the payload, not the header's capacity: the vector grows on later adds.
+        MinHash sketch(capacity, Unreserved());
+        sketch.smallest.reserve(hashCount + 1);
+        for (size_t i = 0; i < hashCount; ++i) {
+            uint64_t hash = readBytes(bytes, offset, 8);
+            if (i > 0 && hash <= sketch.smallest.back()) {
+                throw std::runtime_error("MinHash hashes are not sorted.");
+            }
+            sketch.smallest.push_back(hash);
+        }
+        return sketch;
+    }
+};
+
+// Benchmark
+
+// Written by benchmarks so the optimizer cannot drop the measured loops.
+volatile size_t benchmarkSink = 0;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void benchmarkAccuracy() {
+    // Relative error of the distinct-count estimate over 20 independent streams per cell.
+    const int trials = 20;
+    std::mt19937_64 random(17);
+    std::cout << "Estimate error (mean absolute / worst), 20 trials per cell" << std::endl;
+    for (size_t cardinality : {100, 10000, 1000000}) {
+        std::cout << "  n=" << cardinality << ":";
+        for (int precision : {10, 12, 14}) {
+            double totalError = 0;
+            double worstError = 0;
+            for (int trial = 0; trial < trials; ++trial) {
+                HyperLogLog sketch(precision);
+                for (size_t i = 0; i < cardinality; ++i) {
+                    sketch.add(random());
+                }
+                double error = std::abs(sketch.estimate() / cardinality - 1);
+                totalError += error;
+                worstError = std::max(worstError, error);
+            }
+            std::cout << " HLL p=" << precision << " (" << (size_t(1) << precision) / 1024 << " KB) "
+                      << 100 * totalError / trials << "% / " << 100 * worstError << "%;";
+        }
+        double totalError = 0;
+        double worstError = 0;
+        for (int trial = 0; trial < trials; ++trial) {
+            MinHash sketch(256);
+            for (size_t i = 0; i < cardinality; ++i) {
+                sketch.add(random());
+            }
+            double error = std::abs(sketch.estimate() / cardinality - 1);
+            totalError += error;
+            worstError = std::max(worstError, error);
+        }
+        std::cout << " MinHash k=256 " << 100 * totalError / trials << "% / " << 100 * worstError << "%" << std::endl;
+    }
+}
+
+void benchmarkAgainstExactSets() {
+    // Two 4M-element sets overlapping in 1M elements: exact hash sets vs sketches.
+    const uint64_t elementCount = 4 << 20;
+    std::vector<uint64_t> left(elementCount);
+    std::vector<uint64_t> right(elementCount);
+    for (uint64_t i = 0; i < elementCount; ++i) {
+        left[i] = i;
+        right[i] = i + 3 * elementCount / 4;
+    }
+    double exactUnion = elementCount * 7 / 4.0;
+    double exactJaccard = (elementCount / 4.0) / exactUnion;
+
+    auto start = std::chrono::steady_clock::now();
+    std::unordered_set<uint64_t> exact(left.begin(), left.end());
+    exact.insert(right.begin(), right.end());
+    double exactSeconds = secondsSince(start);
+    benchmarkSink = exact.size();
+
+    start = std::chrono::steady_clock::now();
+    HyperLogLog leftSketch(12);
+    HyperLogLog rightSketch(12);
+    leftSketch.addAll(left);
+    rightSketch.addAll(right);
+    double unionEstimate = leftSketch.estimateUnionWith(rightSketch);
+    double hllSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    MinHash leftMinHash(256);
+    MinHash rightMinHash(256);
+    leftMinHash.addAll(left);
+    rightMinHash.addAll(right);
+    double jaccardEstimate = leftMinHash.jaccard(rightMinHash);
+    double minHashSeconds = secondsSince(start);
+
+    std::cout << "Union of two 4M-element sets (exact " << exactUnion << ", Jaccard " << exactJaccard << ")"
+              << std::endl;
+    size_t exactBytes = exact.bucket_count() * sizeof(void*) + exact.size() * 2 * sizeof(uint64_t);
+    std::cout << "  exact hash set: " << exactSeconds << " s, at least " << exactBytes / 1e6 << " MB" << std::endl;
+    std::cout << "  HyperLogLog p=12: " << hllSeconds << " s, " << 2 * leftSketch.sizeInBytes() << " bytes, union "
+              << unionEstimate << " (" << 100 * (unionEstimate / exactUnion - 1) << "%)" << std::endl;
+    std::cout << "  MinHash k=256: " << minHashSeconds << " s, " << 2 * leftMinHash.sizeInBytes()
+              << " bytes, Jaccard " << jaccardEstimate << " (exact " << exactJaccard << ")" << std::endl;
+}
+
+// Example usage
+int main(int argc, char* argv[]) {
+    HyperLogLog visitors;
+    MinHash mondayVisitors;
+    MinHash tuesdayVisitors;
+    for (int user = 0; user < 50000; ++user) {
+        visitors.add(user);
+        mondayVisitors.add(user);
+        tuesdayVisitors.add(user + 25000);
+    }
+    std::cout << "Distinct visitors: about " << visitors.estimate() << std::endl;
+    std::cout << "Monday/Tuesday Jaccard: about " << mondayVisitors.jaccard(tuesdayVisitors) << std::endl;
+
+    HyperLogLog restored = HyperLogLog::deserialize(visitors.serialize());
+    std::cout << "Restored sketch: about " << restored.estimate() << ", " << restored.sizeInBytes() << " bytes"
+              << std::endl;
+
+    if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+        benchmarkAccuracy();
+        benchmarkAgainstExactSets();
+    }
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+// Hashing and byte order shared by probabilisticFilters.cpp and sketches.cpp. Filters and
+// sketches are serialized and merged across processes, so their hash must not change
+// between builds or standard libraries: integers go through the murmur3 finalizer, strings
+// through FNV-1a. Other key types have no hash with that guarantee (std::hash may differ
+// between standard libraries) and are rejected at compile time.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace stableHashing {
+inline uint64_t mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+inline uint64_t hashBytes(std::string_view bytes) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char byte : bytes) {
+        hash = (hash ^ byte) * 0x100000001b3ULL;
+    }
+    return mix(hash);
+}
+}  // namespace stableHashing
+
+template <typename Key>
+uint64_t stableHash(const Key& key) {
+    if constexpr (std::is_integral<Key>::value || std::is_enum<Key>::value) {
+        return stableHashing::mix(static_cast<uint64_t>(key));
+    } else {
+        static_assert(std::is_convertible<const Key&, std::string_view>::value,
+                      "Keys need a hash that is stable across builds: use an integer, enum or string key");
+        return stableHashing::hashBytes(std::string_view(key));
+    }
+}
+
+// Serialization Helpers (little-endian regardless of the host)
+
+inline void appendBytes(std::vector<uint8_t>& bytes, uint64_t value, size_t width) {
+    for (size_t i = 0; i < width; ++i) {
+        bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+inline uint64_t readBytes(const std::vector<uint8_t>& bytes, size_t& offset, size_t width) {
+    if (offset + width > bytes.size()) {
+        throw std::runtime_error("Truncated input.");
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < width; ++i) {
+        value |= uint64_t(bytes[offset + i]) << (8 * i);
+    }
+    offset += width;
+    return value;
+}
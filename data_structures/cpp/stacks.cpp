@@ -1,10 +1,27 @@
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
 
-template<typename T>
+#include "inlineVector.h"
+#include "pipeline.h"
+
+/// InlineCapacity > 0 keeps up to that many elements inside the stack itself, with no
+/// heap allocation; the default 0 stores them in a std::vector. Either way, heap memory
+/// comes from Allocator.
+template<typename T, size_t InlineCapacity = 0, typename Allocator = std::allocator<T>>
 class CustomStack {
 private:
-    std::vector<T> elements;
+    using Storage = std::conditional_t<InlineCapacity == 0, std::vector<T, Allocator>,
+                                       InlineVector<T, InlineCapacity, Allocator>>;
+
+    Storage elements;
 
 public:
     // MARK: - Stack Operations
@@ -43,7 +60,7 @@ public:
 
     /// Initialize the stack with a vector of elements.
     void initializeWithVector(const std::vector<T>& vec) {
-        elements = vec;
+        elements.assign(vec.begin(), vec.end());
     }
 
     /// Push a vector of elements onto the stack.
@@ -75,54 +92,63 @@ public:
         return std::find(elements.begin(), elements.end(), element) != elements.end();
     }
 
+    // MARK: - Pipeline
+
+    /// Lazy pipeline over the elements from bottom to top; chained map and filter
+    /// stages run as a single pass.
+    auto pipeline() const {
+        auto source = [this](auto&& sink) {
+            for (const T& element : elements) {
+                sink(element);
+            }
+        };
+        return Pipeline<T, decltype(source)>(source, elements.size());
+    }
+
     // MARK: - Filtering
 
     /// Filter the stack using a given predicate.
-    std::vector<T> filter(bool (*predicate)(T)) const {
-        std::vector<T> filtered;
-        for (const T& element : elements) {
-            if (predicate(element)) {
-                filtered.push_back(element);
-            }
-        }
-        return filtered;
+    template<typename Predicate>
+    std::vector<T> filter(Predicate predicate) const {
+        return pipeline().filter(predicate).toVector();
     }
 
     // MARK: - Conversion to Vector
 
     /// Convert the stack to a vector.
     std::vector<T> toVector() const {
-        return elements;
+        return std::vector<T>(elements.begin(), elements.end());
     }
 
     // MARK: - Map
 
     /// Transform each element in the stack using a provided transform function.
+    template<typename Transform>
+    auto map(Transform transform) const {
+        return pipeline().map(transform).toVector();
+    }
+
+    /// Overload for explicit map<U>(transform) calls, which predate map taking any callable.
     template<typename U>
     std::vector<U> map(U (*transform)(T)) const {
-        std::vector<U> mapped;
-        for (const T& element : elements) {
-            mapped.push_back(transform(element));
-        }
-        return mapped;
+        return pipeline().map(transform).toVector();
     }
 
     // MARK: - Reduce
 
     /// Combine all elements in the stack using a reducer function.
-    template<typename Result>
-    Result reduce(Result initialResult, Result (*reducer)(Result, T)) const {
-        Result result = initialResult;
-        for (const T& element : elements) {
-            result = reducer(result, element);
-        }
-        return result;
+    template<typename Result, typename Reducer>
+    Result reduce(Result initialResult, Reducer reducer) const {
+        return pipeline().reduce(std::move(initialResult), reducer);
     }
 
     // MARK: - Concatenate
 
     /// Concatenate another stack to this stack.
-    void concatenate(const CustomStack<T>& otherStack) {
+    void concatenate(const CustomStack& otherStack) {
+        // Reserving first keeps a stack concatenated with itself from reading elements
+        // the reallocation moved away.
+        elements.reserve(elements.size() + otherStack.elements.size());
         elements.insert(elements.end(), otherStack.elements.begin(), otherStack.elements.end());
     }
 
@@ -139,7 +165,80 @@ public:
     // ... Add more stack operations as needed ...
 };
 
-int main() {
+// MARK: - Benchmark
+
+/// Written by benchmarks so the optimizer cannot drop the measured loops.
+volatile size_t benchmarkSink = 0;
+
+/// Allocator that counts the heap allocations of the stacks built with it, for the
+/// small-stack benchmark.
+size_t countedAllocations = 0;
+
+template<typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+
+    T* allocate(size_t count) {
+        ++countedAllocations;
+        return std::allocator<T>().allocate(count);
+    }
+
+    void deallocate(T* pointer, size_t count) {
+        std::allocator<T>().deallocate(pointer, count);
+    }
+
+    template<typename U>
+    bool operator==(const CountingAllocator<U>&) const {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const CountingAllocator<U>&) const {
+        return false;
+    }
+};
+
+/// Push elementCount ints (half one by one, half through pushVector), then pop them all,
+/// on two million short-lived stacks; prints the time and heap allocations per stack.
+template<size_t InlineCapacity>
+void measureSmallStacks(const char* label, size_t elementCount) {
+    constexpr size_t stackCount = 2000000;
+    std::vector<int> batch(elementCount / 2, 7);
+    size_t allocationsBefore = countedAllocations;
+    auto start = std::chrono::steady_clock::now();
+    size_t total = 0;
+    for (size_t i = 0; i < stackCount; ++i) {
+        CustomStack<int, InlineCapacity, CountingAllocator<int>> stack;
+        for (size_t j = batch.size(); j < elementCount; ++j) {
+            stack.push(static_cast<int>(i + j));
+        }
+        stack.pushVector(batch);
+        while (!stack.isEmpty()) {
+            total += stack.pop();
+        }
+    }
+    double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    size_t allocations = countedAllocations - allocationsBefore;
+    benchmarkSink = total;
+    std::cout << " " << label << " " << nanoseconds / stackCount << " ns, "
+              << static_cast<double>(allocations) / stackCount << " allocations;";
+}
+
+void benchmarkSmallStacks() {
+    std::cout << "Short-lived small stacks, per stack (std::vector storage vs InlineCapacity 16)" << std::endl;
+    for (size_t elementCount : {4, 12, 24}) {
+        std::cout << "  n=" << elementCount << ":";
+        measureSmallStacks<0>("vector", elementCount);
+        measureSmallStacks<16>("inline", elementCount);
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
     CustomStack<int> stack;
     stack.push(1);
     stack.push(2);
@@ -150,5 +249,9 @@ int main() {
         std::cout << stack[i] << std::endl;
     }
 
+    if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+        benchmarkSmallStacks();
+    }
+
     return 0;
 }